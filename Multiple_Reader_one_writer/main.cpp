@@ -7,6 +7,8 @@
 #include <mutex>
 #include <shared_mutex>
 
+#include "thread_accounting.h"
+
 
 /*
  * - Financial data feed for infrequently traded stocks
@@ -325,6 +327,18 @@
  *                  std::cout << dist(mt) << ", ";
  *              }*/
 
+/*
+ * Synchronized<T, Lock> (synchronized.h)
+ * - x is only protected by mut because every function remembers to lock it
+ * - Synchronized<int, std::mutex> x; keeps the int and the mutex together
+ *      - ++*x.wlock();                     exclusive lock for one statement
+ *      - std::cout << *x.rlock();          shared lock (if Lock has one)
+ *      - x.withLock([](int &v) { ++v; });  exclusive lock for a function call
+ * - Synchronized<T, Lock, true>::snapshot() copies the data without locking (seqlock)
+ *      - Only for trivially copyable T
+ * - See synchronized_bench.cpp
+ *      */
+
 /*
  * */
 char * reverse_string(char *str) {
@@ -367,6 +381,8 @@ std::shared_mutex shmut;
 // shared variable
 int y {0};
 void write1() {
+    // A writer waits while any reader holds the shared lock; the report shows it as off CPU time
+    ThreadAccount account("write1");
     std::lock_guard<std::shared_mutex> lck_guard(shmut);
     // start of critical section
     ++y;
@@ -374,6 +390,7 @@ void write1() {
 }
 
 void read2() {
+    ThreadAccount account("read2");
     std::shared_lock<std::shared_mutex> lck_guard(shmut);
     using namespace std::literals;
     std::this_thread::sleep_for(100ms);
@@ -443,6 +460,20 @@ int main() {
 //    for (auto &thread: threads) {
 //        thread.join();
 //    }
+
+//    std::vector<std::thread> threads;
+//    for (int i{0}; i < 5; ++i) {
+//        threads.push_back(std::thread(read2));
+//    }
+//    threads.push_back(std::thread(write1));
+//    for (int i{0}; i < 5; ++i) {
+//        threads.push_back(std::thread(read2));
+//    }
+//    for (auto &thread: threads) {
+//        thread.join();
+//    }
+//    // Computing, sleeping or waiting for the lock? (common/thread_accounting.h)
+//    ThreadAccounting::global().report(std::cout);
         std::vector<std::thread> threads;
         for (int i{0}; i < 10; ++i) {
             threads.push_back(std::thread(task));
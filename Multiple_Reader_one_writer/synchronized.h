@@ -0,0 +1,175 @@
+#ifndef MULTIPLE_READER_ONE_WRITER_SYNCHRONIZED_H
+#define MULTIPLE_READER_ONE_WRITER_SYNCHRONIZED_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Synchronized<T, Lock>
+ * - The demos keep the data next to its mutex
+ *          std::mutex mut;
+ *          int x {0};
+ *      - Nothing stops a function from using x without locking mut
+ *
+ * - Synchronized<T, Lock> holds the data and the mutex together
+ *      - The data is private
+ *      - The only way to reach it is through a locked pointer
+ *
+ * - wlock() returns a pointer which holds an exclusive lock
+ * - rlock() returns a pointer to const which holds a shared lock
+ *      - If Lock has no lock_shared(), e.g. std::mutex, rlock() takes an exclusive lock
+ * - The lock is released when the pointer goes out of scope, like std::lock_guard
+ *
+ *          Synchronized<int> x {0};
+ *          ++*x.wlock();
+ *          std::cout << *x.rlock() << std::endl;
+ *          x.withLock([](int &value) { ++value; });
+ *          */
+
+/*
+ * Snapshots (seqlock)
+ * - Readers which only need a copy of a small value still have to lock
+ *      - Even a shared lock is a read-modify-write on the mutex
+ *      - With many readers, that cache line is passed from core to core
+ *
+ * - Synchronized<T, Lock, true> also keeps a sequence number
+ *      - wlock() makes it odd while the writer is in its critical section
+ *      - And even again when the writer unlocks
+ *
+ * - snapshot() does not lock
+ *      - Read the sequence number, copy the data, read the sequence number again
+ *      - If it was odd, or it has changed, a writer interfered - try again
+ *      - Readers never write to shared memory
+ *
+ * - Only for trivially copyable T
+ *      - A torn copy is thrown away, so copying it must have no side effects
+ *      - The copy races with the writer, as in every seqlock; only a copy that was not torn is returned
+ *      */
+
+namespace synchronized_detail {
+    template <typename Lock, typename = void>
+    struct has_lock_shared : std::false_type {};
+
+    template <typename Lock>
+    struct has_lock_shared<Lock, std::void_t<decltype(std::declval<Lock &>().lock_shared())>> : std::true_type {};
+}
+
+struct NoUnlockAction {
+    void operator()() const {}
+};
+
+// Holds a lock, and gives access to the data while it does
+template <typename Pointer, typename LockHolder, typename OnUnlock = NoUnlockAction>
+class LockedPtr {
+public:
+    LockedPtr(Pointer data, LockHolder lock_holder, OnUnlock on_unlock = OnUnlock())
+        : data(data), lock_holder(std::move(lock_holder)), on_unlock(on_unlock) {}
+
+    LockedPtr(const LockedPtr &source) = delete;
+    LockedPtr &operator=(const LockedPtr &source) = delete;
+    LockedPtr(LockedPtr &&source) noexcept
+        : data(source.data), lock_holder(std::move(source.lock_holder)), on_unlock(source.on_unlock) {
+        source.data = nullptr;
+    }
+    LockedPtr &operator=(LockedPtr &&source) = delete;
+
+    // on_unlock runs while the lock is still held, lock_holder is destroyed after it
+    ~LockedPtr() {
+        if (data) {
+            on_unlock();
+        }
+    }
+
+    Pointer operator->() const { return data; }
+    decltype(auto) operator*() const { return *data; }
+
+private:
+    Pointer data;
+    LockHolder lock_holder;
+    OnUnlock on_unlock;
+};
+
+template <typename T, typename Lock = std::shared_mutex, bool Snapshots = false>
+class Synchronized {
+    static constexpr bool shared_lockable = synchronized_detail::has_lock_shared<Lock>::value;
+    using ReadLock = std::conditional_t<shared_lockable, std::shared_lock<Lock>, std::unique_lock<Lock>>;
+
+    // Called by the writer's LockedPtr before it unlocks
+    struct EndWrite {
+        std::atomic<std::uint32_t> *sequence;
+        void operator()() const {
+            if (Snapshots) {
+                sequence->store(sequence->load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+        }
+    };
+
+public:
+    using WritePtr = LockedPtr<T *, std::unique_lock<Lock>, EndWrite>;
+    using ReadPtr = LockedPtr<const T *, ReadLock>;
+
+    static_assert(!Snapshots || std::is_trivially_copyable<T>::value,
+                  "snapshot() copies the data while it may be written, T must be trivially copyable");
+
+    Synchronized() = default;
+    explicit Synchronized(const T &value) : data(value) {}
+    explicit Synchronized(T &&value) : data(std::move(value)) {}
+
+    Synchronized(const Synchronized &source) = delete;
+    Synchronized &operator=(const Synchronized &source) = delete;
+
+    WritePtr wlock() {
+        std::unique_lock<Lock> uniq_lck(mut);
+        if (Snapshots) {
+            // Odd: a write is in progress
+            sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        return WritePtr(&data, std::move(uniq_lck), EndWrite{&sequence});
+    }
+
+    ReadPtr rlock() const {
+        return ReadPtr(&data, ReadLock(mut));
+    }
+
+    template <typename Function>
+    decltype(auto) withLock(Function fn) {
+        auto ptr = wlock();
+        return fn(*ptr);
+    }
+
+    template <typename Function>
+    decltype(auto) withRLock(Function fn) const {
+        auto ptr = rlock();
+        return fn(*ptr);
+    }
+
+    // Lock-free copy of the data, only with Snapshots = true
+    T snapshot() const {
+        static_assert(Snapshots, "snapshot() needs Synchronized<T, Lock, true>");
+        while (true) {
+            auto before = sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            T copy(data);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) {
+                return copy;
+            }
+        }
+    }
+
+private:
+    mutable Lock mut;
+    std::atomic<std::uint32_t> sequence {0};
+    T data {};
+};
+
+#endif //MULTIPLE_READER_ONE_WRITER_SYNCHRONIZED_H
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "synchronized.h"
+#include "topology.h"
+
+using namespace std::literals;
+
+/*
+ * Synchronized<T> read-path benchmark
+ * - Reader threads read a shared value as fast as they can
+ * - One writer thread updates it about every 10 microseconds
+ *
+ * - The shared value is a pair which the writer keeps equal
+ *      - Every reader checks that it never sees a half-written pair
+ *
+ * - Explicit: a global pair next to its mutex, locked with std::lock_guard (like x and mut)
+ * - Explicit shared: the same with std::shared_mutex and std::shared_lock (like y and shmut)
+ * - Synchronized<Pair, std::mutex>::rlock()
+ * - Synchronized<Pair, std::shared_mutex>::rlock()
+ * - Synchronized<Pair, std::shared_mutex, true>::snapshot()
+ *
+ * - The reads per second tables are repeated for each pin policy (common/topology.h)
+ *      - "none" lets the kernel place the threads; the writer is the thread after the last reader
+ *
+ * Usage: synchronized_bench [max readers] [milliseconds per run] [policies, e.g. none,compact,scatter]
+ *      */
+
+struct Pair {
+    long first {0};
+    long second {0};
+};
+
+// Explicit locking, as in the demos
+template <typename Mutex>
+struct ExplicitPair {
+    Mutex mut;
+    Pair pair;
+};
+
+// Each variant is a read function and a write function
+template <typename Read, typename Write>
+double reads_per_second(const ThreadPlacement &placement, unsigned nreaders, std::chrono::milliseconds run_time,
+                        Read read, Write write) {
+    std::atomic<bool> stop {false};
+    std::atomic<long long> total {0};
+    std::atomic<long long> torn {0};
+    std::vector<std::thread> threads;
+
+    for (unsigned t{0}; t < nreaders; ++t) {
+        threads.push_back(placement.launch(t, [&] {
+            long long n {0};
+            long long bad {0};
+            while (!stop.load(std::memory_order_relaxed)) {
+                Pair copy = read();
+                if (copy.first != copy.second) {
+                    ++bad;
+                }
+                ++n;
+            }
+            total += n;
+            torn += bad;
+        }));
+    }
+    threads.push_back(placement.launch(nreaders, [&] {
+        long value {0};
+        while (!stop.load(std::memory_order_relaxed)) {
+            write(++value);
+            std::this_thread::sleep_for(10us);
+        }
+    }));
+
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(run_time);
+    stop.store(true, std::memory_order_relaxed);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (torn != 0) {
+        std::cerr << torn << " torn reads" << std::endl;
+    }
+    return total / elapsed.count();
+}
+
+// Uncontended cost of one read, in nanoseconds
+template <typename Read>
+double read_ns(int iterations, Read read) {
+    long sink {0};
+    auto start = std::chrono::steady_clock::now();
+    for (int i{0}; i < iterations; ++i) {
+        sink += read().first;
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    if (sink < 0) {
+        std::cout << sink;
+    }
+    return elapsed.count() / iterations;
+}
+
+template <typename Function>
+void row(const std::string &name, unsigned max_readers, Function measure) {
+    std::cout << std::setw(24) << std::left << name << std::right;
+    for (unsigned n{1}; n <= max_readers; n *= 2) {
+        std::cout << std::setw(10) << measure(n);
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned max_readers = argc > 1 ? std::atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+    auto run_time = std::chrono::milliseconds(argc > 2 ? std::atoi(argv[2]) : 300);
+    std::stringstream policy_names(argc > 3 ? argv[3] : "none,compact,scatter");
+
+    ExplicitPair<std::mutex> explicit_pair;
+    ExplicitPair<std::shared_mutex> explicit_shared;
+    Synchronized<Pair, std::mutex> sync_mutex;
+    Synchronized<Pair, std::shared_mutex> sync_shared;
+    Synchronized<Pair, std::shared_mutex, true> sync_seqlock;
+
+    auto explicit_read = [&] {
+        std::lock_guard<std::mutex> lck_guard(explicit_pair.mut);
+        return explicit_pair.pair;
+    };
+    auto explicit_write = [&](long value) {
+        std::lock_guard<std::mutex> lck_guard(explicit_pair.mut);
+        explicit_pair.pair.first = value;
+        explicit_pair.pair.second = value;
+    };
+    auto explicit_shared_read = [&] {
+        std::shared_lock<std::shared_mutex> shr_lck(explicit_shared.mut);
+        return explicit_shared.pair;
+    };
+    auto explicit_shared_write = [&](long value) {
+        std::lock_guard<std::shared_mutex> lck_guard(explicit_shared.mut);
+        explicit_shared.pair.first = value;
+        explicit_shared.pair.second = value;
+    };
+    auto set = [](long value) {
+        return [value](Pair &pair) {
+            pair.first = value;
+            pair.second = value;
+        };
+    };
+    auto sync_mutex_read = [&] { return *sync_mutex.rlock(); };
+    auto sync_mutex_write = [&](long value) { sync_mutex.withLock(set(value)); };
+    auto sync_shared_read = [&] { return *sync_shared.rlock(); };
+    auto sync_shared_write = [&](long value) { sync_shared.withLock(set(value)); };
+    auto snapshot_read = [&] { return sync_seqlock.snapshot(); };
+    auto snapshot_write = [&](long value) { sync_seqlock.withLock(set(value)); };
+
+    const int iterations {10000000};
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "uncontended read (ns)" << std::endl;
+    std::cout << "  explicit lock_guard        " << read_ns(iterations, explicit_read) << std::endl;
+    std::cout << "  explicit shared_lock       " << read_ns(iterations, explicit_shared_read) << std::endl;
+    std::cout << "  Synchronized<mutex>        " << read_ns(iterations, sync_mutex_read) << std::endl;
+    std::cout << "  Synchronized<shared_mutex> " << read_ns(iterations, sync_shared_read) << std::endl;
+    std::cout << "  snapshot()                 " << read_ns(iterations, snapshot_read) << std::endl;
+
+    std::cout << std::endl;
+    CpuTopology::system().describe(std::cout);
+    std::cout << std::endl;
+
+    std::string name;
+    while (std::getline(policy_names, name, ',')) {
+        PinPolicy policy;
+        if (!pin_policy_from_name(name, policy)) {
+            std::cerr << "unknown pin policy " << name << std::endl;
+            return 1;
+        }
+        ThreadPlacement placement(policy);
+
+        std::cout << std::endl << "reads per second (M), one writer, pin policy " << name << std::endl;
+        std::cout << std::setw(24) << std::left << "readers" << std::right;
+        for (unsigned n{1}; n <= max_readers; n *= 2) {
+            std::cout << std::setw(10) << n;
+        }
+        std::cout << std::endl;
+
+        row("explicit lock_guard", max_readers, [&](unsigned n) {
+            return reads_per_second(placement, n, run_time, explicit_read, explicit_write) / 1e6;
+        });
+        row("explicit shared_lock", max_readers, [&](unsigned n) {
+            return reads_per_second(placement, n, run_time, explicit_shared_read, explicit_shared_write) / 1e6;
+        });
+        row("Synchronized<mutex>", max_readers, [&](unsigned n) {
+            return reads_per_second(placement, n, run_time, sync_mutex_read, sync_mutex_write) / 1e6;
+        });
+        row("Synchronized<shared>", max_readers, [&](unsigned n) {
+            return reads_per_second(placement, n, run_time, sync_shared_read, sync_shared_write) / 1e6;
+        });
+        row("snapshot()", max_readers, [&](unsigned n) {
+            return reads_per_second(placement, n, run_time, snapshot_read, snapshot_write) / 1e6;
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,238 @@
+#ifndef MULTIPLE_THREADS_RACE_CONDITIONS_CONCURRENT_VECTOR_H
+#define MULTIPLE_THREADS_RACE_CONDITIONS_CONCURRENT_VECTOR_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <utility>
+
+/*
+ * ConcurrentVector
+ * - enter() shares one std::vector between threads, protected by a mutex
+ *      - push_back() may reallocate, moving every element to a new array
+ *      - So a reader must hold the same mutex, even to look at an element which already exists
+ *
+ * - ConcurrentVector stores its elements in segments
+ *      - A segment is never reallocated, so an element never moves once it has been added
+ *      - When the segments are full, the next one is allocated and added to the segment table
+ *      - The first segment holds 64 elements, and each one after that is twice as big as the last
+ *
+ * - push_back(value) and grow_by(n, value) do not take a lock
+ *      - fetch_add on the count reserves the indexes
+ *      - The first thread to need a new segment allocates it, and installs it with compare_exchange
+ *      - The element is constructed, then marked as ready
+ *      - Returns the index of the (first) new element
+ *
+ * - size() counts the elements at the start which are all ready
+ *      - operator[](i) and iteration are safe for any i < size(), while other threads append
+ *      - An element whose append started later, but finished sooner, is not counted until
+ *        all the ones before it are ready
+ *
+ * - Elements cannot be removed, and there is no clear(): it is an append-only vector
+ *      - Element access gives a reference; modifying an element while others read it is still a data race
+ *      */
+
+namespace concurrent_vector_detail {
+    // Index of the highest set bit; n must not be 0
+    inline unsigned log2(std::size_t n) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(n));
+#else
+        unsigned result {0};
+        while (n >>= 1) {
+            ++result;
+        }
+        return result;
+#endif
+    }
+}
+
+template <typename T>
+class ConcurrentVector {
+    struct Slot {
+        std::atomic<bool> ready {false};
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *get() { return std::launder(reinterpret_cast<T *>(storage)); }
+    };
+
+public:
+    class const_iterator;
+
+    ConcurrentVector() = default;
+
+    ConcurrentVector(const ConcurrentVector &source) = delete;
+    ConcurrentVector &operator=(const ConcurrentVector &source) = delete;
+
+    // No other thread may be using the vector
+    ~ConcurrentVector() {
+        std::size_t count = reserved.load();
+        for (std::size_t k{0}; k < segments.size(); ++k) {
+            Slot *segment = segments[k].load();
+            if (!segment) {
+                continue;
+            }
+            for (std::size_t i{0}; i < segment_size(k) && segment_start(k) + i < count; ++i) {
+                if (segment[i].ready.load()) {
+                    segment[i].get()->~T();
+                }
+            }
+            delete[] segment;
+        }
+    }
+
+    template <typename... Args>
+    std::size_t emplace_back(Args &&...args) {
+        std::size_t index = reserved.fetch_add(1);
+        construct(index, std::forward<Args>(args)...);
+        publish();
+        return index;
+    }
+
+    std::size_t push_back(const T &value) { return emplace_back(value); }
+    std::size_t push_back(T &&value) { return emplace_back(std::move(value)); }
+
+    // Appends n copies of value, at consecutive indexes
+    std::size_t grow_by(std::size_t n, const T &value = T()) {
+        std::size_t first = reserved.fetch_add(n);
+        for (std::size_t i{0}; i < n; ++i) {
+            construct(first + i, value);
+        }
+        publish();
+        return first;
+    }
+
+    // Number of elements which can be read
+    std::size_t size() const { return published.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+
+    T &operator[](std::size_t index) { return *slot(index).get(); }
+    const T &operator[](std::size_t index) const { return *slot(index).get(); }
+
+    // Iterates over the elements which were ready when begin() was called
+    const_iterator begin() const { return const_iterator(this, 0, size()); }
+    const_iterator end() const { return const_iterator(this, size(), size()); }
+
+    // Walks one segment at a time, rather than locating every element from its index
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        const_iterator() = default;
+
+        reference operator*() const { return *current->get(); }
+        pointer operator->() const { return current->get(); }
+
+        const_iterator &operator++() {
+            ++index;
+            if (++current == segment_end && index < last) {
+                enter_segment();
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        bool operator==(const const_iterator &other) const { return index == other.index; }
+        bool operator!=(const const_iterator &other) const { return index != other.index; }
+
+    private:
+        friend class ConcurrentVector;
+
+        const_iterator(const ConcurrentVector *vec, std::size_t index, std::size_t last)
+            : vec(vec), index(index), last(last) {
+            if (index < last) {
+                enter_segment();
+            }
+        }
+
+        void enter_segment() {
+            auto [k, offset] = locate(index);
+            current = vec->segments[k].load(std::memory_order_acquire) + offset;
+            segment_end = current + (segment_size(k) - offset);
+        }
+
+        const ConcurrentVector *vec {nullptr};
+        std::size_t index {0};
+        std::size_t last {0};
+        Slot *current {nullptr};
+        Slot *segment_end {nullptr};
+    };
+
+private:
+    static constexpr unsigned first_segment_bits {6};
+    static constexpr std::size_t first_segment_size {std::size_t{1} << first_segment_bits};
+
+    // Segment k holds the indexes [first_segment_size * (2^k - 1), first_segment_size * (2^(k + 1) - 1))
+    static std::size_t segment_size(std::size_t k) { return first_segment_size << k; }
+    static std::size_t segment_start(std::size_t k) { return first_segment_size * ((std::size_t{1} << k) - 1); }
+
+    // Segment number and offset in the segment
+    static std::pair<std::size_t, std::size_t> locate(std::size_t index) {
+        std::size_t shifted = index + first_segment_size;
+        unsigned high_bit = concurrent_vector_detail::log2(shifted);
+        return {high_bit - first_segment_bits, shifted - (std::size_t{1} << high_bit)};
+    }
+
+    Slot &slot(std::size_t index) const {
+        auto [k, offset] = locate(index);
+        return segments[k].load(std::memory_order_acquire)[offset];
+    }
+
+    // Returns segment k, allocating it if no other thread has yet
+    Slot *segment(std::size_t k) {
+        Slot *existing = segments[k].load(std::memory_order_acquire);
+        if (existing) {
+            return existing;
+        }
+        Slot *fresh = new Slot[segment_size(k)];
+        if (segments[k].compare_exchange_strong(existing, fresh, std::memory_order_acq_rel)) {
+            return fresh;
+        }
+        delete[] fresh;  // another thread installed it first
+        return existing;
+    }
+
+    template <typename... Args>
+    void construct(std::size_t index, Args &&...args) {
+        auto [k, offset] = locate(index);
+        Slot &target = segment(k)[offset];
+        new (target.storage) T(std::forward<Args>(args)...);
+        target.ready.store(true);
+    }
+
+    // A slot which has been reserved may not have a segment yet
+    bool is_ready(std::size_t index) const {
+        auto [k, offset] = locate(index);
+        Slot *segment = segments[k].load(std::memory_order_acquire);
+        return segment && segment[offset].ready.load();
+    }
+
+    // Move "published" past every ready element
+    // Whichever of two appending threads finishes last sees the other's element ready, so none is left behind
+    // (this needs the seq_cst stores and loads of "ready")
+    void publish() {
+        std::size_t count = published.load();
+        while (count < reserved.load() && is_ready(count)) {
+            if (published.compare_exchange_weak(count, count + 1)) {
+                ++count;
+            }
+        }
+    }
+
+    std::array<std::atomic<Slot *>, sizeof(std::size_t) * 8 - first_segment_bits> segments {};
+    std::atomic<std::size_t> reserved {0};
+    std::atomic<std::size_t> published {0};
+};
+
+#endif //MULTIPLE_THREADS_RACE_CONDITIONS_CONCURRENT_VECTOR_H
@@ -0,0 +1,137 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "concurrent_vector.h"
+
+/*
+ * ConcurrentVector benchmark
+ * - Append: each thread push_back()s its share of the ints
+ *      - ConcurrentVector vs std::vector with a mutex around push_back(), as in enter()
+ *      - While appending, one more thread keeps reading the newest element
+ *      - Reports million appends per second, and how many reads the reader managed
+ * - Iterate: add up every element, after the appends
+ *      - ConcurrentVector iterator, ConcurrentVector operator[], std::vector
+ *
+ * Usage: concurrent_vector_bench [number of ints] [appending threads]
+ *      */
+
+using bench_clock = std::chrono::steady_clock;
+
+struct AppendResult {
+    double seconds;
+    long long reads;
+};
+
+// Run nthreads appenders and one reader until the appenders are done
+template <typename Append, typename Read>
+AppendResult append_with_reader(unsigned nthreads, long long count, Append append, Read read) {
+    std::atomic<bool> done {false};
+    long long reads {0};
+    std::thread reader([&] {
+        while (!done.load()) {
+            read();
+            ++reads;
+        }
+    });
+
+    auto start = bench_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t{0}; t < nthreads; ++t) {
+        threads.push_back(std::thread([&, t] {
+            for (long long i = count * t / nthreads; i < count * (t + 1) / nthreads; ++i) {
+                append(static_cast<int>(i % 100));
+            }
+        }));
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = bench_clock::now() - start;
+    done = true;
+    reader.join();
+    return {elapsed.count(), reads};
+}
+
+template <typename Function>
+void timed_sum(const std::string &name, long long count, Function fn) {
+    auto start = bench_clock::now();
+    long long total = fn();
+    std::chrono::duration<double, std::nano> elapsed = bench_clock::now() - start;
+    std::cout << "  " << std::setw(26) << std::left << name << std::right << std::setw(8)
+              << elapsed.count() / count << " ns/element   total " << total << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    long long count = argc > 1 ? std::atoll(argv[1]) : 10000000LL;
+    unsigned nthreads = argc > 2 ? std::atoi(argv[2]) : std::max(2u, std::thread::hardware_concurrency());
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << count << " ints, " << nthreads << " appending threads" << std::endl;
+
+    ConcurrentVector<int> concurrent;
+    volatile int sink {0};
+    auto lock_free = append_with_reader(nthreads, count,
+        [&](int value) { concurrent.push_back(value); },
+        [&] {
+            auto size = concurrent.size();
+            if (size > 0) {
+                sink = concurrent[size - 1];
+            }
+        });
+
+    std::vector<int> guarded;
+    std::mutex protect;
+    auto locked = append_with_reader(nthreads, count,
+        [&](int value) {
+            std::lock_guard<std::mutex> lck_guard(protect);
+            guarded.push_back(value);
+        },
+        [&] {
+            std::lock_guard<std::mutex> lck_guard(protect);
+            if (!guarded.empty()) {
+                sink = guarded.back();
+            }
+        });
+
+    std::cout << "append                       M/s      reads" << std::endl;
+    std::cout << "  ConcurrentVector     " << std::setw(12) << count / lock_free.seconds / 1e6
+              << std::setw(11) << lock_free.reads << std::endl;
+    std::cout << "  std::vector + mutex  " << std::setw(12) << count / locked.seconds / 1e6
+              << std::setw(11) << locked.reads << std::endl;
+
+    if (concurrent.size() != static_cast<std::size_t>(count)) {
+        std::cerr << "ConcurrentVector has " << concurrent.size() << " elements" << std::endl;
+        return 1;
+    }
+
+    std::cout << "iterate" << std::endl;
+    timed_sum("ConcurrentVector iterator", count, [&] {
+        long long total {0};
+        for (int value : concurrent) {
+            total += value;
+        }
+        return total;
+    });
+    timed_sum("ConcurrentVector []", count, [&] {
+        long long total {0};
+        for (std::size_t i{0}; i < concurrent.size(); ++i) {
+            total += concurrent[i];
+        }
+        return total;
+    });
+    timed_sum("std::vector", count, [&] {
+        long long total {0};
+        for (int value : guarded) {
+            total += value;
+        }
+        return total;
+    });
+    return 0;
+}
@@ -0,0 +1,177 @@
+#ifndef MULTIPLE_THREADS_RACE_CONDITIONS_DEFERRED_COUNTER_H
+#define MULTIPLE_THREADS_RACE_CONDITIONS_DEFERRED_COUNTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * DeferredCounter
+ * - increment_int() and increment_value() (in deadlock) take a lock, or do an atomic
+ *   read-modify-write, for every single increment
+ * - StripedCounter spreads that over several cache lines, but it is still one atomic per increment
+ *
+ * - DeferredCounter adds into a thread_local accumulator instead
+ *      - add() is a load and a store on memory only this thread writes, and a count
+ *      - The accumulator is flushed into the shared total:
+ *          - every "flush_ops" calls to add()
+ *          - on an add() at least "flush_interval" after the last flush (the clock is read every 64 adds)
+ *          - when the thread calls flush()
+ *          - when the thread exits
+ *
+ * - read(): the flushed total, one relaxed load
+ *      - Bounded staleness: behind by less than flush_ops increments per thread which is still adding,
+ *        and by no more than about flush_interval of them
+ *      - A thread which stops adding keeps its remainder until it flushes or exits
+ * - read_all(): the total plus every thread's accumulator, under a mutex
+ *      - Exact once the adding threads have stopped (joined, or just waiting), with or without a flush
+ *      - While they run, it can only be behind, and by no more than the increments in flight
+ *
+ * - The counter may be destroyed before the threads which used it have exited
+ *      - Their accumulators are detached from it, and freed on that thread's next add() to any counter
+ *        of this type, or when it exits
+ *      */
+
+template <typename T = long long>
+class DeferredCounter {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit DeferredCounter(std::uint32_t flush_ops = 1024,
+                             std::chrono::microseconds flush_interval = std::chrono::microseconds(1000))
+        : flush_ops(std::max<std::uint32_t>(flush_ops, 1)), flush_interval(flush_interval) {}
+
+    DeferredCounter(const DeferredCounter &source) = delete;
+    DeferredCounter &operator=(const DeferredCounter &source) = delete;
+
+    ~DeferredCounter() {
+        std::lock_guard<std::mutex> lck_guard(registry_mutex);
+        for (auto *local : locals) {
+            local->counter.store(nullptr, std::memory_order_release);
+        }
+    }
+
+    void add(T n = 1) {
+        Local &local = local_for_this_thread();
+        // Only this thread writes "pending"; read_all() reads it
+        local.pending.store(local.pending.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        ++local.ops;
+        if (local.ops >= flush_ops || ((local.ops & 63) == 0 && clock::now() - local.last_flush >= flush_interval)) {
+            flush(local);
+        }
+    }
+
+    DeferredCounter &operator++() {
+        add(1);
+        return *this;
+    }
+
+    // Moves this thread's accumulator into the total
+    void flush() {
+        if (Local *local = find_local()) {
+            flush(*local);
+        }
+    }
+
+    T read() const { return total.load(std::memory_order_relaxed); }
+
+    T read_all() const {
+        std::lock_guard<std::mutex> lck_guard(registry_mutex);
+        T sum = total.load(std::memory_order_acquire);
+        for (auto *local : locals) {
+            sum += local->pending.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+private:
+    struct alignas(64) Local {
+        std::atomic<DeferredCounter *> counter;
+        std::atomic<T> pending {0};
+        std::uint32_t ops {0};
+        clock::time_point last_flush {clock::now()};
+    };
+
+    // One per thread: the accumulators of every counter of this type that the thread has added to
+    struct Table {
+        std::vector<std::unique_ptr<Local>> locals;
+        Local *last {nullptr};
+
+        ~Table() {
+            std::lock_guard<std::mutex> lck_guard(registry_mutex);
+            for (auto &local : locals) {
+                if (auto *counter = local->counter.load(std::memory_order_acquire)) {
+                    counter->total.fetch_add(local->pending.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    auto &registered = counter->locals;
+                    registered.erase(std::find(registered.begin(), registered.end(), local.get()));
+                }
+            }
+        }
+    };
+
+    static Table &table() {
+        thread_local Table table;
+        return table;
+    }
+
+    Local *find_local() {
+        Table &t = table();
+        if (t.last != nullptr && t.last->counter.load(std::memory_order_relaxed) == this) {
+            return t.last;
+        }
+        for (auto &local : t.locals) {
+            if (local->counter.load(std::memory_order_relaxed) == this) {
+                t.last = local.get();
+                return t.last;
+            }
+        }
+        return nullptr;
+    }
+
+    Local &local_for_this_thread() {
+        if (Local *local = find_local()) {
+            return *local;
+        }
+        Table &t = table();
+        // Drop the accumulators of counters which have been destroyed
+        t.locals.erase(std::remove_if(t.locals.begin(), t.locals.end(), [](const std::unique_ptr<Local> &local) {
+            return local->counter.load(std::memory_order_acquire) == nullptr;
+        }), t.locals.end());
+
+        auto local = std::make_unique<Local>();
+        local->counter.store(this, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lck_guard(registry_mutex);
+            locals.push_back(local.get());
+        }
+        t.locals.push_back(std::move(local));
+        t.last = t.locals.back().get();
+        return *t.last;
+    }
+
+    void flush(Local &local) {
+        // Clear pending first, so read_all() may miss the amount for a moment but never counts it twice:
+        // a read_all() which sees the new total (acquire) also sees pending cleared (release)
+        T amount = local.pending.load(std::memory_order_relaxed);
+        local.pending.store(0, std::memory_order_relaxed);
+        total.fetch_add(amount, std::memory_order_release);
+        local.ops = 0;
+        local.last_flush = clock::now();
+    }
+
+    const std::uint32_t flush_ops;
+    const std::chrono::microseconds flush_interval;
+    alignas(64) std::atomic<T> total {0};
+    std::vector<Local *> locals;  // Guarded by registry_mutex
+
+    // Registration, thread exit and the destructor; never taken by add() after a thread's first one
+    // Constant-initialized, so it outlives every counter, even a global one like deferred_int in main.cpp,
+    // and every thread's Table
+    static inline std::mutex registry_mutex;
+};
+
+#endif //MULTIPLE_THREADS_RACE_CONDITIONS_DEFERRED_COUNTER_H
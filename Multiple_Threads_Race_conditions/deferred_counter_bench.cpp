@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "deferred_counter.h"
+#include "striped_counter.h"
+
+/*
+ * DeferredCounter benchmark
+ * - Increments per second: every thread increments one shared counter many times, 1 thread up to 64
+ *      - mutex: lock_guard around ++, like increment_value() in deadlock
+ *      - atomic: std::atomic<long long>::fetch_add
+ *      - striped: StripedCounter::add()
+ *      - deferred: DeferredCounter::add(), flushing every 1024 adds or 1 ms
+ *      - Every run checks the total once the threads have exited
+ *
+ * - Staleness: writer threads add for a while, and a reader keeps calling read()
+ *      - How far read() is behind read_all() (which includes what has not been flushed yet),
+ *        mean and max, in increments, for a few flush_ops settings
+ *      - Compared with the bound: writers * flush_ops
+ *
+ * Usage: deferred_counter_bench [max threads] [increments per thread] [staleness milliseconds]
+ *      */
+
+// Runs increment() "increments" times on each of nthreads threads, returns millions of increments per second
+template <typename Increment>
+double mops(unsigned nthreads, int increments, Increment increment) {
+    std::atomic<bool> start {false};
+    std::vector<std::thread> threads;
+    for (unsigned t{0}; t < nthreads; ++t) {
+        threads.push_back(std::thread([&] {
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (int i{0}; i < increments; ++i) {
+                increment();
+            }
+        }));
+    }
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return static_cast<double>(nthreads) * increments / elapsed.count() / 1e6;
+}
+
+void check(const std::string &name, long long total, long long expected) {
+    if (total != expected) {
+        std::cerr << name << ": total " << total << ", expected " << expected << std::endl;
+    }
+}
+
+void staleness(unsigned nwriters, std::uint32_t flush_ops, std::chrono::milliseconds run_time) {
+    DeferredCounter<long long> counter(flush_ops);
+    std::atomic<bool> stop {false};
+    std::vector<std::thread> writers;
+    for (unsigned t{0}; t < nwriters; ++t) {
+        writers.push_back(std::thread([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i{0}; i < 256; ++i) {
+                    counter.add(1);
+                }
+            }
+        }));
+    }
+
+    long long samples {0}, sum {0}, worst {0};
+    auto end = std::chrono::steady_clock::now() + run_time;
+    while (std::chrono::steady_clock::now() < end) {
+        long long flushed = counter.read();
+        long long behind = std::max(0LL, counter.read_all() - flushed);
+        sum += behind;
+        worst = std::max(worst, behind);
+        ++samples;
+        std::this_thread::yield();
+    }
+    stop = true;
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    check("staleness", counter.read(), counter.read_all());
+    std::cout << std::setw(10) << flush_ops << std::setw(14) << static_cast<double>(sum) / std::max(1LL, samples)
+              << std::setw(12) << worst << std::setw(12) << static_cast<long long>(nwriters) * flush_ops << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned max_threads = argc > 1 ? std::atoi(argv[1]) : 64;
+    int increments = argc > 2 ? std::atoi(argv[2]) : 1000000;
+    auto run_time = std::chrono::milliseconds(argc > 3 ? std::atoi(argv[3]) : 300);
+
+    std::cout << "millions of increments per second, " << increments << " per thread" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "mutex" << std::setw(12) << "atomic"
+              << std::setw(12) << "striped" << std::setw(12) << "deferred" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (unsigned n{1}; n <= max_threads; n *= 2) {
+        long long expected = static_cast<long long>(n) * increments;
+
+        std::mutex mut;
+        long long mutex_value {0};
+        auto mutex_mops = mops(n, increments, [&] {
+            std::lock_guard<std::mutex> lck_guard(mut);
+            ++mutex_value;
+        });
+        check("mutex", mutex_value, expected);
+
+        std::atomic<long long> atomic_value {0};
+        auto atomic_mops = mops(n, increments, [&] { atomic_value.fetch_add(1, std::memory_order_relaxed); });
+        check("atomic", atomic_value.load(), expected);
+
+        StripedCounter<long long> striped;
+        auto striped_mops = mops(n, increments, [&] { striped.add(1); });
+        check("striped", striped.read(), expected);
+
+        DeferredCounter<long long> deferred;
+        auto deferred_mops = mops(n, increments, [&] { deferred.add(1); });
+        // The threads have exited, so everything has been flushed
+        check("deferred", deferred.read(), expected);
+
+        std::cout << std::setw(8) << n << std::setw(12) << mutex_mops << std::setw(12) << atomic_mops
+                  << std::setw(12) << striped_mops << std::setw(12) << deferred_mops << std::endl;
+    }
+
+    unsigned nwriters = std::max(2u, std::thread::hardware_concurrency() - 1);
+    std::cout << std::endl << "read() behind read_all(), " << nwriters << " writers, " << run_time.count() << " ms"
+              << std::endl;
+    std::cout << std::setw(10) << "flush_ops" << std::setw(14) << "mean" << std::setw(12) << "max"
+              << std::setw(12) << "bound" << std::endl;
+    for (std::uint32_t flush_ops : {64u, 1024u, 16384u}) {
+        staleness(nwriters, flush_ops, run_time);
+    }
+    return 0;
+}
@@ -0,0 +1,462 @@
+#include "fiber.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if (defined(__x86_64__) || defined(__aarch64__)) && !defined(FIBER_USE_UCONTEXT)
+#define FIBER_ASM_SWITCH 1
+#else
+#define FIBER_ASM_SWITCH 0
+#include <ucontext.h>
+#endif
+
+/*
+ * Context switching
+ * - The compiler already saves the "caller-saved" registers around a function call
+ * - So switching fibers only has to save the "callee-saved" registers and the stack pointer
+ *      - Push them on the current stack, store the stack pointer in the old fiber
+ *      - Load the new fiber's stack pointer, pop its registers, return
+ *      - The return lands wherever the new fiber was when it switched out
+ *
+ * - A new fiber's stack is made to look as if it had switched out
+ *      - The return address is fiber_trampoline, which calls fiber_entry(fiber)
+ *      - The Fiber pointer is in a callee-saved register (rbx / x19)
+ *      */
+
+namespace fiber_detail {
+    struct Fiber;
+}
+
+extern "C" void fiber_entry(fiber_detail::Fiber *fiber);
+
+#if FIBER_ASM_SWITCH
+
+extern "C" void fiber_switch_context(void **save_sp, void *load_sp);
+extern "C" void fiber_trampoline();
+
+#if defined(__APPLE__)
+#define FIBER_SYMBOL(name) "_" #name
+#define FIBER_FUNCTION_TYPE(name)
+#define FIBER_CALL(name) FIBER_SYMBOL(name)
+#else
+#define FIBER_SYMBOL(name) #name
+#define FIBER_FUNCTION_TYPE(name) ".type " #name ", @function\n"
+#define FIBER_CALL(name) #name "@PLT"
+#endif
+
+#if defined(__x86_64__)
+asm(".text\n"
+    ".globl " FIBER_SYMBOL(fiber_switch_context) "\n"
+    FIBER_FUNCTION_TYPE(fiber_switch_context)
+    ".p2align 4\n"
+    FIBER_SYMBOL(fiber_switch_context) ":\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".globl " FIBER_SYMBOL(fiber_trampoline) "\n"
+    FIBER_FUNCTION_TYPE(fiber_trampoline)
+    ".p2align 4\n"
+    FIBER_SYMBOL(fiber_trampoline) ":\n"
+    "    movq %rbx, %rdi\n"
+    "    call " FIBER_CALL(fiber_entry) "\n"
+    "    ud2\n");
+
+// Saved by fiber_switch_context, lowest address first
+constexpr std::size_t fiber_register_slot {4};   // rbx
+constexpr std::size_t return_address_slot {6};
+constexpr std::size_t initial_frame_bytes {72};  // 7 slots, and 16-byte alignment after the return
+
+#elif defined(__aarch64__)
+asm(".text\n"
+    ".globl " FIBER_SYMBOL(fiber_switch_context) "\n"
+    FIBER_FUNCTION_TYPE(fiber_switch_context)
+    ".p2align 2\n"
+    FIBER_SYMBOL(fiber_switch_context) ":\n"
+    "    sub sp, sp, #0xb0\n"
+    "    stp x19, x20, [sp, #0x00]\n"
+    "    stp x21, x22, [sp, #0x10]\n"
+    "    stp x23, x24, [sp, #0x20]\n"
+    "    stp x25, x26, [sp, #0x30]\n"
+    "    stp x27, x28, [sp, #0x40]\n"
+    "    stp x29, x30, [sp, #0x50]\n"
+    "    stp d8, d9, [sp, #0x60]\n"
+    "    stp d10, d11, [sp, #0x70]\n"
+    "    stp d12, d13, [sp, #0x80]\n"
+    "    stp d14, d15, [sp, #0x90]\n"
+    "    mov x2, sp\n"
+    "    str x2, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldp x19, x20, [sp, #0x00]\n"
+    "    ldp x21, x22, [sp, #0x10]\n"
+    "    ldp x23, x24, [sp, #0x20]\n"
+    "    ldp x25, x26, [sp, #0x30]\n"
+    "    ldp x27, x28, [sp, #0x40]\n"
+    "    ldp x29, x30, [sp, #0x50]\n"
+    "    ldp d8, d9, [sp, #0x60]\n"
+    "    ldp d10, d11, [sp, #0x70]\n"
+    "    ldp d12, d13, [sp, #0x80]\n"
+    "    ldp d14, d15, [sp, #0x90]\n"
+    "    add sp, sp, #0xb0\n"
+    "    ret\n"
+    ".globl " FIBER_SYMBOL(fiber_trampoline) "\n"
+    FIBER_FUNCTION_TYPE(fiber_trampoline)
+    ".p2align 2\n"
+    FIBER_SYMBOL(fiber_trampoline) ":\n"
+    "    mov x0, x19\n"
+    "    bl " FIBER_SYMBOL(fiber_entry) "\n"
+    "    brk #0\n");
+
+constexpr std::size_t fiber_register_slot {0};   // x19
+constexpr std::size_t return_address_slot {11};  // x30
+constexpr std::size_t initial_frame_bytes {0xb0};
+#endif
+
+#endif // FIBER_ASM_SWITCH
+
+namespace fiber_detail {
+
+    struct Fiber {
+#if FIBER_ASM_SWITCH
+        void *sp {nullptr};
+#else
+        ucontext_t context;
+#endif
+        char *stack {nullptr};
+        std::function<void()> fn;
+        FiberScheduler::Impl *scheduler {nullptr};
+    };
+
+    // What the worker does once the fiber has switched out, and is off its stack
+    enum class AfterSwitch { nothing, requeue, release_guard, destroy };
+
+    struct Worker {
+#if FIBER_ASM_SWITCH
+        void *sp {nullptr};
+#else
+        ucontext_t context;
+#endif
+        Fiber *current {nullptr};
+        AfterSwitch after {AfterSwitch::nothing};
+        SpinLock *guard {nullptr};
+    };
+
+    thread_local Worker *this_thread_worker {nullptr};
+
+    // Not inline: a fiber can move to another thread, so the thread_local must be looked up again each time
+    __attribute__((noinline)) Worker *current_worker() {
+        return this_thread_worker;
+    }
+}
+
+struct FiberScheduler::Impl {
+    Impl(std::size_t stack_size, bool guard_pages);
+    ~Impl();
+
+    void push(fiber_detail::Fiber *fiber) {
+        {
+            std::lock_guard<std::mutex> lck_guard(queue_mutex);
+            run_queue.push_back(fiber);
+        }
+        queue_cv.notify_one();
+    }
+
+    void run_worker();
+    void after_switch(fiber_detail::Worker &worker, fiber_detail::Fiber *fiber);
+    char *allocate_stack();
+    void release_stack(char *stack);
+
+    std::size_t stack_size;
+    bool guard_pages;
+    std::mutex stack_mutex;
+    std::vector<std::pair<void *, std::size_t>> mappings;
+    std::vector<char *> free_stacks;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<fiber_detail::Fiber *> run_queue;
+    bool stopping {false};
+    std::size_t live {0};
+    std::condition_variable idle_cv;
+    std::vector<std::thread> workers;
+};
+
+namespace {
+    using fiber_detail::AfterSwitch;
+    using fiber_detail::Fiber;
+    using fiber_detail::Worker;
+
+    std::size_t page_size() {
+        static const std::size_t size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+#if !FIBER_ASM_SWITCH
+    void ucontext_entry(unsigned high, unsigned low) {
+        auto address = (static_cast<std::uintptr_t>(high) << 32) | low;
+        fiber_entry(reinterpret_cast<Fiber *>(address));
+    }
+#endif
+
+    void prepare_context(Fiber &fiber) {
+#if FIBER_ASM_SWITCH
+        auto *stack_top = fiber.stack + fiber.scheduler->stack_size;
+        auto **frame = reinterpret_cast<void **>(stack_top - initial_frame_bytes);
+        for (std::size_t i{0}; i < initial_frame_bytes / sizeof(void *); ++i) {
+            frame[i] = nullptr;
+        }
+        frame[fiber_register_slot] = &fiber;
+        frame[return_address_slot] = reinterpret_cast<void *>(&fiber_trampoline);
+        fiber.sp = frame;
+#else
+        getcontext(&fiber.context);
+        fiber.context.uc_stack.ss_sp = fiber.stack;
+        fiber.context.uc_stack.ss_size = fiber.scheduler->stack_size;
+        fiber.context.uc_link = nullptr;
+        auto address = reinterpret_cast<std::uintptr_t>(&fiber);
+        makecontext(&fiber.context, reinterpret_cast<void (*)()>(&ucontext_entry), 2,
+                    static_cast<unsigned>(address >> 32), static_cast<unsigned>(address));
+#endif
+    }
+
+    void switch_to_fiber(Worker &worker, Fiber &fiber) {
+#if FIBER_ASM_SWITCH
+        fiber_switch_context(&worker.sp, fiber.sp);
+#else
+        swapcontext(&worker.context, &fiber.context);
+#endif
+    }
+
+    // Called on the fiber's stack: go back to the worker, which carries out "after"
+    void switch_to_worker(Fiber &fiber, AfterSwitch after, fiber_detail::SpinLock *guard = nullptr) {
+        auto *worker = fiber_detail::current_worker();
+        worker->after = after;
+        worker->guard = guard;
+#if FIBER_ASM_SWITCH
+        fiber_switch_context(&fiber.sp, worker->sp);
+#else
+        swapcontext(&fiber.context, &worker->context);
+#endif
+    }
+}
+
+extern "C" void fiber_entry(Fiber *fiber) {
+    try {
+        fiber->fn();
+    }
+    catch (const std::exception &e) {
+        std::cerr << "fiber threw: " << e.what() << std::endl;
+        std::abort();
+    }
+    catch (...) {
+        // Unwinding past the fiber's first frame would leave its stack, which has no caller
+        std::cerr << "fiber threw an exception which is not a std::exception" << std::endl;
+        std::abort();
+    }
+    fiber->fn = nullptr;
+    switch_to_worker(*fiber, AfterSwitch::destroy);
+    std::abort();
+}
+
+/*
+ * Stacks
+ * - Stacks are reused: a finished fiber's stack goes on a free list for the next spawn()
+ *      - Saves an mmap() and munmap() system call per fiber
+ *      - They are only unmapped when the scheduler is destroyed
+ *
+ * - With guard pages, each stack is its own mapping, with an inaccessible page below it
+ *      - Overflowing the stack crashes at once, instead of overwriting another fiber's stack
+ *      - But the guard splits the mapping in two, and Linux limits a process to about 65,000 mappings
+ *
+ * - Without guard pages, stacks are carved out of larger mappings, 64 stacks at a time
+ *      - For hundreds of thousands of fibers with shallow call stacks
+ *      */
+
+constexpr std::size_t stacks_per_mapping {64};
+
+FiberScheduler::Impl::Impl(std::size_t requested_stack_size, bool guard_pages) : guard_pages(guard_pages) {
+    auto page = page_size();
+    stack_size = (requested_stack_size + page - 1) / page * page;
+}
+
+FiberScheduler::Impl::~Impl() {
+    for (auto &mapping : mappings) {
+        munmap(mapping.first, mapping.second);
+    }
+}
+
+char *FiberScheduler::Impl::allocate_stack() {
+    std::lock_guard<std::mutex> lck_guard(stack_mutex);
+    if (free_stacks.empty()) {
+        auto page = page_size();
+        std::size_t size = guard_pages ? page + stack_size : stacks_per_mapping * stack_size;
+        void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        mappings.emplace_back(mapping, size);
+        auto *base = static_cast<char *>(mapping);
+        if (guard_pages) {
+            mprotect(base, page, PROT_NONE);
+            free_stacks.push_back(base + page);
+        }
+        else {
+            for (std::size_t i{0}; i < stacks_per_mapping; ++i) {
+                free_stacks.push_back(base + i * stack_size);
+            }
+        }
+    }
+    auto *stack = free_stacks.back();
+    free_stacks.pop_back();
+    return stack;
+}
+
+void FiberScheduler::Impl::release_stack(char *stack) {
+    std::lock_guard<std::mutex> lck_guard(stack_mutex);
+    free_stacks.push_back(stack);
+}
+
+void FiberScheduler::Impl::run_worker() {
+    Worker worker;
+    fiber_detail::this_thread_worker = &worker;
+    while (true) {
+        std::unique_lock<std::mutex> uniq_lck(queue_mutex);
+        queue_cv.wait(uniq_lck, [this] { return stopping || !run_queue.empty(); });
+        if (run_queue.empty()) {
+            return;
+        }
+        auto *fiber = run_queue.front();
+        run_queue.pop_front();
+        uniq_lck.unlock();
+
+        worker.current = fiber;
+        switch_to_fiber(worker, *fiber);
+        worker.current = nullptr;
+        after_switch(worker, fiber);
+    }
+}
+
+void FiberScheduler::Impl::after_switch(Worker &worker, Fiber *fiber) {
+    switch (worker.after) {
+        case AfterSwitch::requeue:
+            push(fiber);
+            break;
+        case AfterSwitch::release_guard:
+            // The fiber is now on a waiting list; whoever takes it off will schedule it
+            worker.guard->unlock();
+            break;
+        case AfterSwitch::destroy: {
+            release_stack(fiber->stack);
+            delete fiber;
+            std::lock_guard<std::mutex> lck_guard(queue_mutex);
+            if (--live == 0) {
+                idle_cv.notify_all();
+            }
+            break;
+        }
+        case AfterSwitch::nothing:
+            break;
+    }
+    worker.after = AfterSwitch::nothing;
+    worker.guard = nullptr;
+}
+
+FiberScheduler::FiberScheduler(unsigned nthreads, std::size_t stack_size, bool guard_pages)
+    : impl(new Impl(stack_size, guard_pages)) {
+    if (nthreads == 0) {
+        nthreads = 1;
+    }
+    for (unsigned i{0}; i < nthreads; ++i) {
+        impl->workers.emplace_back([this] { impl->run_worker(); });
+    }
+}
+
+FiberScheduler::~FiberScheduler() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lck_guard(impl->queue_mutex);
+        impl->stopping = true;
+    }
+    impl->queue_cv.notify_all();
+    for (auto &worker : impl->workers) {
+        worker.join();
+    }
+}
+
+void FiberScheduler::spawn(std::function<void()> fn) {
+    auto *fiber = new Fiber;
+    try {
+        fiber->stack = impl->allocate_stack();
+    }
+    catch (...) {
+        delete fiber;
+        throw;
+    }
+    fiber->fn = std::move(fn);
+    fiber->scheduler = impl.get();
+    prepare_context(*fiber);
+    {
+        std::lock_guard<std::mutex> lck_guard(impl->queue_mutex);
+        ++impl->live;
+    }
+    impl->push(fiber);
+}
+
+void FiberScheduler::wait() {
+    std::unique_lock<std::mutex> uniq_lck(impl->queue_mutex);
+    impl->idle_cv.wait(uniq_lck, [this] { return impl->live == 0; });
+}
+
+unsigned FiberScheduler::size() const {
+    return static_cast<unsigned>(impl->workers.size());
+}
+
+namespace fiber_detail {
+    Fiber *current_fiber() {
+        auto *worker = current_worker();
+        return worker ? worker->current : nullptr;
+    }
+
+    void suspend_and_unlock(SpinLock &guard) {
+        switch_to_worker(*current_fiber(), AfterSwitch::release_guard, &guard);
+    }
+
+    void schedule(Fiber *fiber) {
+        fiber->scheduler->push(fiber);
+    }
+}
+
+namespace this_fiber {
+    void yield() {
+        auto *fiber = fiber_detail::current_fiber();
+        if (fiber) {
+            switch_to_worker(*fiber, AfterSwitch::requeue);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+
+    bool inside() {
+        return fiber_detail::current_fiber() != nullptr;
+    }
+}
@@ -0,0 +1,157 @@
+#ifndef MULTIPLE_THREADS_RACE_CONDITIONS_FIBER_H
+#define MULTIPLE_THREADS_RACE_CONDITIONS_FIBER_H
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+
+/*
+ * Fibers
+ * - hello(), hola() and bonjour() each get a std::thread, just to print one line
+ *      - A std::thread is a kernel thread: a kernel task, and a stack of several megabytes of address space
+ *      - Starting one is a system call, switching between them goes through the kernel scheduler
+ *      - 100,000 greetings would mean 100,000 kernel threads
+ *
+ * - A fiber is a thread which the program schedules itself
+ *      - It has its own stack, so it can be suspended in the middle of any function (a "stackful coroutine")
+ *      - Switching fibers saves a few registers and changes the stack pointer - no system call
+ *      - The stack is small (64 kB by default), and only the pages which are used take memory
+ *
+ * - FiberScheduler runs many fibers on a few kernel threads ("M:N scheduling")
+ *      - spawn(fn) creates a fiber which runs fn
+ *      - Each worker thread takes a fiber off the run queue and switches to it
+ *      - The fiber runs until it finishes, calls this_fiber::yield(), or waits for a FiberMutex
+ *      - A fiber may be resumed on a different worker thread from the one it was suspended on
+ *
+ * - A fiber must not block its worker thread for long
+ *      - std::mutex::lock() or sleep_for() stops every fiber queued behind it on that worker
+ *      - FiberMutex suspends the fiber instead, and the worker runs another one
+ *
+ * - Context switching is written in assembly for x86-64 and AArch64
+ *      - Other platforms use swapcontext(), which is slower (it makes a system call)
+ *      */
+
+namespace fiber_detail {
+    struct Fiber;
+
+    // Spin lock for short critical sections, which can be released on another fiber's stack
+    class SpinLock {
+    public:
+        void lock() {
+            while (flag.test_and_set(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+        }
+        void unlock() { flag.clear(std::memory_order_release); }
+
+    private:
+        std::atomic_flag flag = ATOMIC_FLAG_INIT;
+    };
+
+    // The fiber running on this thread, or nullptr
+    Fiber *current_fiber();
+    // Suspend the current fiber; the worker releases "guard" once the fiber is off its stack
+    void suspend_and_unlock(SpinLock &guard);
+    // Put a suspended fiber back on its scheduler's run queue
+    void schedule(Fiber *fiber);
+}
+
+class FiberScheduler {
+public:
+    // Without guard pages, a stack overflow silently corrupts memory - see fiber.cpp
+    explicit FiberScheduler(unsigned nthreads = std::thread::hardware_concurrency(),
+                            std::size_t stack_size = 64 * 1024, bool guard_pages = true);
+    // Waits for every fiber to finish
+    ~FiberScheduler();
+
+    FiberScheduler(const FiberScheduler &source) = delete;
+    FiberScheduler &operator=(const FiberScheduler &source) = delete;
+
+    void spawn(std::function<void()> fn);
+
+    // Blocks the calling kernel thread until every fiber has finished
+    void wait();
+
+    unsigned size() const;
+
+    struct Impl;
+
+private:
+    std::unique_ptr<Impl> impl;
+};
+
+namespace this_fiber {
+    // Let the other fibers run; outside a fiber, std::this_thread::yield()
+    void yield();
+
+    // true if the caller is running on a fiber
+    bool inside();
+}
+
+/*
+ * FiberMutex
+ * - lock() on a locked FiberMutex suspends the fiber, not the worker thread
+ * - unlock() hands the mutex straight to the first waiter, and puts it back on the run queue
+ *      - Waiters get the mutex in the order they asked for it
+ * - Can also be used from ordinary threads, which poll instead of suspending
+ * - Works with std::lock_guard and std::unique_lock
+ *      */
+
+class FiberMutex {
+public:
+    FiberMutex() = default;
+    FiberMutex(const FiberMutex &source) = delete;
+    FiberMutex &operator=(const FiberMutex &source) = delete;
+
+    void lock() {
+        while (true) {
+            guard.lock();
+            if (!locked) {
+                locked = true;
+                guard.unlock();
+                return;
+            }
+            auto *self = fiber_detail::current_fiber();
+            if (self) {
+                waiters.push_back(self);
+                // unlock() sets "locked" for us before resuming us
+                fiber_detail::suspend_and_unlock(guard);
+                return;
+            }
+            guard.unlock();
+            std::this_thread::yield();
+        }
+    }
+
+    bool try_lock() {
+        guard.lock();
+        bool acquired = !locked;
+        locked = true;
+        guard.unlock();
+        return acquired;
+    }
+
+    void unlock() {
+        guard.lock();
+        if (waiters.empty()) {
+            locked = false;
+            guard.unlock();
+            return;
+        }
+        // Hand over: "locked" stays true, the waiter owns the mutex now
+        auto *next = waiters.front();
+        waiters.pop_front();
+        guard.unlock();
+        fiber_detail::schedule(next);
+    }
+
+private:
+    fiber_detail::SpinLock guard;
+    bool locked {false};
+    std::deque<fiber_detail::Fiber *> waiters;
+};
+
+#endif //MULTIPLE_THREADS_RACE_CONDITIONS_FIBER_H
@@ -0,0 +1,197 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fiber.h"
+
+/*
+ * Fiber benchmark
+ * - Spawn: start a fiber which does nothing, until it has finished
+ *      - vs creating and joining a std::thread
+ * - Switch: two fibers take turns with this_fiber::yield(), on one worker thread
+ *      - vs two std::threads taking turns with a mutex and condition variable
+ * - Memory: fibers all waiting for one FiberMutex
+ *      - vs std::threads all waiting for one std::mutex
+ *      - RSS and address space from /proc/self/status (0 where it does not exist, e.g. macOS)
+ * - Greetings: hello, hola and bonjour from 100,000 fibers, as hello()/hola()/bonjour() do with threads
+ *      - Each greeting is formatted and counted under a FiberMutex
+ *
+ * - The large runs use stacks without guard pages, see fiber.cpp
+ *
+ * Usage: fiber_bench [fibers] [std::threads] [worker threads]
+ *      */
+
+using bench_clock = std::chrono::steady_clock;
+
+// Read a "VmRSS:" style line from /proc/self/status, in kB
+long proc_status_kb(const std::string &field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size(), field) == 0) {
+            return std::stol(line.substr(field.size()));
+        }
+    }
+    return 0;
+}
+
+template <typename Function>
+double ns_per(long count, Function fn) {
+    auto start = bench_clock::now();
+    fn();
+    std::chrono::duration<double, std::nano> elapsed = bench_clock::now() - start;
+    return elapsed.count() / count;
+}
+
+void spawn_cost(int nfibers, int nthreads, unsigned nworkers) {
+    auto fiber_ns = ns_per(nfibers, [&] {
+        FiberScheduler scheduler(nworkers, 64 * 1024, false);
+        for (int i{0}; i < nfibers; ++i) {
+            scheduler.spawn([] {});
+        }
+        scheduler.wait();
+    });
+    auto guarded_ns = ns_per(nfibers, [&] {
+        FiberScheduler scheduler(nworkers);
+        for (int i{0}; i < nfibers; ++i) {
+            scheduler.spawn([] {});
+        }
+        scheduler.wait();
+    });
+    auto thread_ns = ns_per(nthreads, [&] {
+        for (int i{0}; i < nthreads; ++i) {
+            std::thread thr([] {});
+            thr.join();
+        }
+    });
+    std::cout << "spawn + finish (ns)" << std::endl;
+    std::cout << "  fiber                  " << fiber_ns << std::endl;
+    std::cout << "  fiber, guard pages     " << guarded_ns << std::endl;
+    std::cout << "  std::thread            " << thread_ns << std::endl;
+}
+
+void switch_cost(int switches) {
+    auto fiber_ns = ns_per(switches, [&] {
+        FiberScheduler scheduler(1);
+        for (int f{0}; f < 2; ++f) {
+            scheduler.spawn([switches] {
+                for (int i{0}; i < switches / 2; ++i) {
+                    this_fiber::yield();
+                }
+            });
+        }
+        scheduler.wait();
+    });
+
+    auto thread_ns = ns_per(switches, [&] {
+        std::mutex mut;
+        std::condition_variable cv;
+        int turn {0};
+        auto player = [&](int me) {
+            for (int i{0}; i < switches / 2; ++i) {
+                std::unique_lock<std::mutex> uniq_lck(mut);
+                cv.wait(uniq_lck, [&] { return turn == me; });
+                turn = 1 - me;
+                cv.notify_one();
+            }
+        };
+        std::thread thr1(player, 0);
+        std::thread thr2(player, 1);
+        thr1.join(), thr2.join();
+    });
+    std::cout << "switch (ns)" << std::endl;
+    std::cout << "  fiber yield            " << fiber_ns << std::endl;
+    std::cout << "  std::thread handoff    " << thread_ns << std::endl;
+}
+
+void memory_cost(int nfibers, int nthreads, unsigned nworkers) {
+    {
+        FiberScheduler scheduler(nworkers, 64 * 1024, false);
+        FiberMutex mut;
+        std::atomic<int> arrived {0};
+        mut.lock();
+        long rss_before = proc_status_kb("VmRSS:");
+        long vm_before = proc_status_kb("VmSize:");
+        for (int i{0}; i < nfibers; ++i) {
+            scheduler.spawn([&] {
+                arrived.fetch_add(1);
+                std::lock_guard<FiberMutex> lck_guard(mut);
+            });
+        }
+        while (arrived.load() < nfibers) {
+            std::this_thread::yield();
+        }
+        long rss_after = proc_status_kb("VmRSS:");
+        long vm_after = proc_status_kb("VmSize:");
+        mut.unlock();
+        scheduler.wait();
+        std::cout << "memory per waiter (bytes)" << std::endl;
+        std::cout << "  fiber RSS              " << (rss_after - rss_before) * 1024.0 / nfibers << std::endl;
+        std::cout << "  fiber address space    " << (vm_after - vm_before) * 1024.0 / nfibers << std::endl;
+    }
+    {
+        std::mutex mut;
+        std::atomic<int> arrived {0};
+        std::vector<std::thread> threads;
+        std::unique_lock<std::mutex> uniq_lck(mut);
+        long rss_before = proc_status_kb("VmRSS:");
+        long vm_before = proc_status_kb("VmSize:");
+        for (int i{0}; i < nthreads; ++i) {
+            threads.push_back(std::thread([&] {
+                arrived.fetch_add(1);
+                std::lock_guard<std::mutex> lck_guard(mut);
+            }));
+        }
+        while (arrived.load() < nthreads) {
+            std::this_thread::yield();
+        }
+        long rss_after = proc_status_kb("VmRSS:");
+        long vm_after = proc_status_kb("VmSize:");
+        uniq_lck.unlock();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        std::cout << "  std::thread RSS        " << (rss_after - rss_before) * 1024.0 / nthreads << std::endl;
+        std::cout << "  std::thread addr space " << (vm_after - vm_before) * 1024.0 / nthreads << std::endl;
+    }
+}
+
+void greetings(int nfibers, unsigned nworkers) {
+    const char *words[] {"hello", "hola", "bonjour"};
+    FiberMutex print_mut;
+    long long characters {0};
+    auto ms = ns_per(1000000, [&] {
+        FiberScheduler scheduler(nworkers, 64 * 1024, false);
+        for (int i{0}; i < nfibers; ++i) {
+            scheduler.spawn([&, i] {
+                std::string line = std::string(words[i % 3]) + " from fiber " + std::to_string(i);
+                std::lock_guard<FiberMutex> lck_guard(print_mut);
+                characters += static_cast<long long>(line.size());
+            });
+        }
+    });
+    std::cout << "greetings" << std::endl;
+    std::cout << "  " << nfibers << " fibers in " << ms << " ms (" << characters << " characters)" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int nfibers = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int nthreads = argc > 2 ? std::atoi(argv[2]) : 1000;
+    unsigned nworkers = argc > 3 ? std::atoi(argv[3]) : std::thread::hardware_concurrency();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << nworkers << " worker threads" << std::endl;
+    spawn_cost(nfibers, nthreads, nworkers);
+    switch_cost(1000000);
+    memory_cost(nfibers, nthreads, nworkers);
+    greetings(nfibers, nworkers);
+    return 0;
+}
@@ -0,0 +1,530 @@
+#ifndef MULTIPLE_THREADS_RACE_CONDITIONS_FUTURE_H
+#define MULTIPLE_THREADS_RACE_CONDITIONS_FUTURE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.h"
+
+/*
+ * Future and Promise
+ * - The threads hand back their results through globals, e.g. global_int, protected by a mutex
+ * - A Promise<T> is where one thread puts a result, a Future<T> is where another one gets it
+ *      - promise.set_value(v) or promise.set_exception(e), once
+ *      - future.get() waits for the result, and returns it (or rethrows the exception)
+ *      - A Promise destroyed without a result gives its Future a broken_promise std::future_error
+ *
+ * - future.then(fn) attaches a continuation, and returns a Future for its result
+ *      - fn(value) runs as soon as the value is there, without anyone waiting for it
+ *      - then(fn) runs it inline: on the thread which sets the value, or straight away if it is already set
+ *      - then(pool, fn) submits it to a ThreadPool
+ *      - If the future holds an exception, fn is skipped and the exception is passed on
+ *      - An inline chain runs recursively, so keep inline chains short (thousands, not millions)
+ *
+ * - when_all(futures) gives a Future of all the values, when_any(futures) the index and value of the first
+ * - async_on(pool, fn) runs fn on a ThreadPool and returns a Future for its result
+ *
+ * - The result and the continuation live in one "shared state", allocated once per future
+ *      - The producer sets the value, then moves the state from "empty" to "has result" with compare_exchange
+ *      - The consumer stores its continuation, then moves the state from "empty" to "has continuation"
+ *      - Whichever of them loses the race runs the continuation: no lock, and it runs exactly once
+ *      - The continuation object of then() is part of the next future's shared state, so it costs no allocation
+ *      - get() waits with a mutex and condition variable on its own stack, only if the result is not there yet
+ *
+ * - A Future has one consumer: get() and then() use it up, like std::future::get()
+ *      */
+
+template <typename T>
+class Future;
+
+template <typename T>
+class Promise;
+
+namespace future_detail {
+    struct Unit {};
+
+    // What the shared state stores: void is stored as an empty struct
+    template <typename T>
+    using stored_t = std::conditional_t<std::is_void_v<T>, Unit, T>;
+
+    class Continuation {
+    public:
+        virtual void run() = 0;
+
+    protected:
+        ~Continuation() = default;
+    };
+
+    template <typename T>
+    class SharedState {
+    public:
+        virtual ~SharedState() = default;
+
+        void add_ref() { refs.fetch_add(1, std::memory_order_relaxed); }
+        void release() {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete this;
+            }
+        }
+
+        template <typename... Args>
+        void set_value(Args &&...args) {
+            value.emplace(std::forward<Args>(args)...);
+            complete();
+        }
+
+        void set_exception(std::exception_ptr exception) {
+            error = std::move(exception);
+            complete();
+        }
+
+        bool ready() const {
+            int current = state.load(std::memory_order_acquire);
+            return current == has_result || current == done;
+        }
+
+        // Runs c once the result is there; only one continuation per state
+        void attach(Continuation *c) {
+            continuation = c;
+            int expected {empty};
+            if (!state.compare_exchange_strong(expected, has_continuation, std::memory_order_acq_rel,
+                                               std::memory_order_acquire)) {
+                c->run();  // the result was already there
+            }
+        }
+
+        void wait() {
+            if (ready()) {
+                return;
+            }
+            struct Waiter : Continuation {
+                void run() override {
+                    // Notify with the lock held: the waiter's stack frame goes away as soon as it sees "woken"
+                    std::lock_guard<std::mutex> lck_guard(mut);
+                    woken = true;
+                    cv.notify_one();
+                }
+                std::mutex mut;
+                std::condition_variable cv;
+                bool woken {false};
+            } waiter;
+            attach(&waiter);
+            std::unique_lock<std::mutex> uniq_lck(waiter.mut);
+            waiter.cv.wait(uniq_lck, [&waiter] { return waiter.woken; });
+        }
+
+        // After the result is there
+        std::optional<stored_t<T>> value;
+        std::exception_ptr error;
+
+    protected:
+        // Starts at 1, for whoever creates the state
+        std::atomic<int> refs {1};
+
+    private:
+        enum { empty, has_result, has_continuation, done };
+
+        void complete() {
+            int expected {empty};
+            if (!state.compare_exchange_strong(expected, has_result, std::memory_order_acq_rel,
+                                               std::memory_order_acquire)) {
+                state.store(done, std::memory_order_release);
+                continuation->run();
+            }
+        }
+
+        std::atomic<int> state {empty};
+        Continuation *continuation {nullptr};
+    };
+
+    // Call fn with the parent's value (or nothing, for void), and store what it returns in "target"
+    template <typename T, typename R, typename F>
+    void invoke_into(SharedState<R> *target, F &fn, SharedState<T> *source) {
+        try {
+            if (source->error) {
+                target->set_exception(source->error);
+            }
+            else if constexpr (std::is_void_v<T> && std::is_void_v<R>) {
+                fn();
+                target->set_value();
+            }
+            else if constexpr (std::is_void_v<T>) {
+                target->set_value(fn());
+            }
+            else if constexpr (std::is_void_v<R>) {
+                fn(std::move(*source->value));
+                target->set_value();
+            }
+            else {
+                target->set_value(fn(std::move(*source->value)));
+            }
+        }
+        catch (...) {
+            target->set_exception(std::current_exception());
+        }
+    }
+
+    struct Inline {};
+
+    // The state of the future returned by then(): also the continuation of the parent
+    template <typename T, typename R, typename F, typename Executor>
+    class ThenState : public SharedState<R>, public Continuation {
+    public:
+        ThenState(SharedState<T> *parent, F fn, Executor *executor)
+            : parent(parent), fn(std::move(fn)), executor(executor) {
+            this->refs.store(2, std::memory_order_relaxed);  // the returned Future, and the pending continuation
+        }
+
+        void attach_to_parent() { parent->attach(this); }
+
+        void run() override {
+            if constexpr (std::is_same_v<Executor, Inline>) {
+                fire();
+            }
+            else {
+                executor->submit([this] { fire(); });
+            }
+        }
+
+    private:
+        void fire() {
+            invoke_into(static_cast<SharedState<R> *>(this), fn, parent);
+            parent->release();
+            this->release();
+        }
+
+        SharedState<T> *parent;
+        F fn;
+        Executor *executor;
+    };
+
+    template <typename T, typename F>
+    using then_result_t = typename std::conditional_t<std::is_void_v<T>, std::invoke_result<F>,
+                                                      std::invoke_result<F, T>>::type;
+}
+
+template <typename T>
+class Future {
+public:
+    using value_type = T;
+
+    Future() = default;
+
+    Future(const Future &source) = delete;
+    Future &operator=(const Future &source) = delete;
+
+    Future(Future &&source) noexcept : state(std::exchange(source.state, nullptr)) {}
+    Future &operator=(Future &&source) noexcept {
+        if (this != &source) {
+            reset();
+            state = std::exchange(source.state, nullptr);
+        }
+        return *this;
+    }
+
+    ~Future() { reset(); }
+
+    bool valid() const { return state != nullptr; }
+    bool ready() const { return state && state->ready(); }
+
+    void wait() const { state->wait(); }
+
+    T get() {
+        if (!state) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        state->wait();
+        auto *owned = std::exchange(state, nullptr);
+        struct Release {
+            future_detail::SharedState<T> *state;
+            ~Release() { state->release(); }
+        } release {owned};
+        if (owned->error) {
+            std::rethrow_exception(owned->error);
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*owned->value);
+        }
+    }
+
+    // fn(value), or fn() for Future<void>, inline on whichever thread completes this future
+    template <typename F>
+    auto then(F fn) -> Future<future_detail::then_result_t<T, F>> {
+        return attach_then(std::move(fn), static_cast<future_detail::Inline *>(nullptr));
+    }
+
+    // fn(value) submitted to the executor, e.g. a ThreadPool
+    template <typename Executor, typename F>
+    auto then(Executor &executor, F fn) -> Future<future_detail::then_result_t<T, F>> {
+        return attach_then(std::move(fn), &executor);
+    }
+
+private:
+    template <typename U>
+    friend class Future;
+    template <typename U>
+    friend class Promise;
+    template <typename U>
+    friend Future<std::vector<U>> when_all(std::vector<Future<U>> futures);
+    template <typename U>
+    friend Future<std::pair<std::size_t, U>> when_any(std::vector<Future<U>> futures);
+
+    explicit Future(future_detail::SharedState<T> *state) : state(state) {}
+
+    template <typename F, typename Executor>
+    auto attach_then(F fn, Executor *executor) -> Future<future_detail::then_result_t<T, F>> {
+        using R = future_detail::then_result_t<T, F>;
+        if (!state) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        auto *next = new future_detail::ThenState<T, R, F, Executor>(std::exchange(state, nullptr), std::move(fn), executor);
+        Future<R> result(static_cast<future_detail::SharedState<R> *>(next));
+        next->attach_to_parent();
+        return result;
+    }
+
+    void reset() {
+        if (state) {
+            std::exchange(state, nullptr)->release();
+        }
+    }
+
+    future_detail::SharedState<T> *state {nullptr};
+};
+
+template <typename T>
+class Promise {
+public:
+    Promise() : state(new future_detail::SharedState<T>()) {}
+
+    Promise(const Promise &source) = delete;
+    Promise &operator=(const Promise &source) = delete;
+
+    Promise(Promise &&source) noexcept
+        : state(std::exchange(source.state, nullptr)), satisfied(source.satisfied) {}
+
+    ~Promise() {
+        if (state) {
+            if (!satisfied) {
+                state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+            }
+            state->release();
+        }
+    }
+
+    // Once only
+    Future<T> get_future() {
+        state->add_ref();
+        return Future<T>(state);
+    }
+
+    template <typename... Args>
+    void set_value(Args &&...args) {
+        satisfied = true;
+        state->set_value(std::forward<Args>(args)...);
+    }
+
+    void set_exception(std::exception_ptr exception) {
+        satisfied = true;
+        state->set_exception(std::move(exception));
+    }
+
+private:
+    future_detail::SharedState<T> *state;
+    bool satisfied {false};
+};
+
+template <typename T, typename V = std::decay_t<T>>
+Future<V> make_ready_future(T &&value) {
+    Promise<V> promise;
+    promise.set_value(std::forward<T>(value));
+    return promise.get_future();
+}
+
+inline Future<void> make_ready_future() {
+    Promise<void> promise;
+    promise.set_value();
+    return promise.get_future();
+}
+
+template <typename Function>
+auto async_on(ThreadPool &pool, Function fn) -> Future<std::invoke_result_t<Function>> {
+    return make_ready_future().then(pool, std::move(fn));
+}
+
+namespace future_detail {
+    // Shared by when_all and when_any: one continuation per input future
+    template <typename T, typename Owner>
+    struct Input : Continuation {
+        void run() override { owner->input_ready(*this); }
+
+        Owner *owner {nullptr};
+        SharedState<T> *state {nullptr};
+        std::size_t index {0};
+    };
+
+    template <typename T>
+    class WhenAllState : public SharedState<std::vector<T>> {
+    public:
+        explicit WhenAllState(std::vector<SharedState<T> *> states)
+            : inputs(states.size()), results(states.size()), remaining(states.size()) {
+            this->refs.store(2, std::memory_order_relaxed);  // the returned Future, and the inputs
+            for (std::size_t i{0}; i < states.size(); ++i) {
+                inputs[i].owner = this;
+                inputs[i].state = states[i];
+                inputs[i].index = i;
+            }
+        }
+
+        void start() {
+            for (auto &input : inputs) {
+                input.state->attach(&input);
+            }
+        }
+
+        void input_ready(Input<T, WhenAllState> &input) {
+            if (input.state->error) {
+                errors_seen.store(true, std::memory_order_relaxed);
+            }
+            else {
+                results[input.index].emplace(std::move(*input.state->value));
+            }
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                finish();
+            }
+        }
+
+    private:
+        void finish() {
+            if (errors_seen.load(std::memory_order_relaxed)) {
+                // The first failed input, in the order they were given
+                for (auto &input : inputs) {
+                    if (input.state->error) {
+                        this->set_exception(input.state->error);
+                        break;
+                    }
+                }
+            }
+            else {
+                std::vector<T> values;
+                values.reserve(results.size());
+                for (auto &result : results) {
+                    values.push_back(std::move(*result));
+                }
+                this->set_value(std::move(values));
+            }
+            for (auto &input : inputs) {
+                input.state->release();
+            }
+            this->release();
+        }
+
+        std::vector<Input<T, WhenAllState>> inputs;
+        std::vector<std::optional<T>> results;
+        std::atomic<std::size_t> remaining;
+        std::atomic<bool> errors_seen {false};
+    };
+
+    template <typename T>
+    class WhenAnyState : public SharedState<std::pair<std::size_t, T>> {
+    public:
+        explicit WhenAnyState(std::vector<SharedState<T> *> states)
+            : inputs(states.size()), remaining(states.size()) {
+            this->refs.store(2, std::memory_order_relaxed);
+            for (std::size_t i{0}; i < states.size(); ++i) {
+                inputs[i].owner = this;
+                inputs[i].state = states[i];
+                inputs[i].index = i;
+            }
+        }
+
+        void start() {
+            for (auto &input : inputs) {
+                input.state->attach(&input);
+            }
+        }
+
+        void input_ready(Input<T, WhenAnyState> &input) {
+            if (!claimed.exchange(true, std::memory_order_acq_rel)) {
+                if (input.state->error) {
+                    this->set_exception(input.state->error);
+                }
+                else {
+                    this->set_value(input.index, std::move(*input.state->value));
+                }
+            }
+            // The others are kept alive until they finish too
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                for (auto &each : inputs) {
+                    each.state->release();
+                }
+                this->release();
+            }
+        }
+
+    private:
+        std::vector<Input<T, WhenAnyState>> inputs;
+        std::atomic<std::size_t> remaining;
+        std::atomic<bool> claimed {false};
+    };
+}
+
+// Ready when every future is; holds the first exception (in argument order) if any of them failed
+template <typename T>
+Future<std::vector<T>> when_all(std::vector<Future<T>> futures) {
+    static_assert(!std::is_void_v<T>, "when_all needs futures with values");
+    if (futures.empty()) {
+        return make_ready_future(std::vector<T>());
+    }
+    // Check them all before taking any, so a throw leaves every state with its future, which releases it
+    for (auto &future : futures) {
+        if (!future.state) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+    }
+    std::vector<future_detail::SharedState<T> *> states;
+    states.reserve(futures.size());
+    for (auto &future : futures) {
+        states.push_back(std::exchange(future.state, nullptr));
+    }
+    auto *all = new future_detail::WhenAllState<T>(std::move(states));
+    Future<std::vector<T>> result(static_cast<future_detail::SharedState<std::vector<T>> *>(all));
+    all->start();
+    return result;
+}
+
+// Ready when the first future is: its index, and its value or exception
+template <typename T>
+Future<std::pair<std::size_t, T>> when_any(std::vector<Future<T>> futures) {
+    static_assert(!std::is_void_v<T>, "when_any needs futures with values");
+    if (futures.empty()) {
+        throw std::invalid_argument("when_any of no futures");
+    }
+    // Check them all before taking any, so a throw leaves every state with its future, which releases it
+    for (auto &future : futures) {
+        if (!future.state) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+    }
+    std::vector<future_detail::SharedState<T> *> states;
+    states.reserve(futures.size());
+    for (auto &future : futures) {
+        states.push_back(std::exchange(future.state, nullptr));
+    }
+    auto *any = new future_detail::WhenAnyState<T>(std::move(states));
+    Future<std::pair<std::size_t, T>> result(static_cast<future_detail::SharedState<std::pair<std::size_t, T>> *>(any));
+    any->start();
+    return result;
+}
+
+#endif //MULTIPLE_THREADS_RACE_CONDITIONS_FUTURE_H
@@ -0,0 +1,140 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "future.h"
+
+/*
+ * Future benchmark
+ * - Chain: a value goes through "steps" continuations, each adding one
+ *      - then(fn) inline: the whole chain runs on the thread which sets the first value
+ *      - then(pool, fn): each step is a task on a ThreadPool
+ *      - std::async: each step is a std::async(std::launch::async) which get()s the step before
+ *      - Reports ns and heap allocations per step, from building the chain to getting the result
+ * - Round trip: a new thread sets a value, while the main thread is blocked in get()
+ *      - Promise/Future vs std::promise/std::future; both include starting the thread
+ * - when_all / when_any over futures from async_on(pool, ...)
+ *
+ * - Allocations are counted by replacing the global operator new
+ *
+ * Usage: future_bench [steps] [round trips]
+ *      */
+
+std::atomic<long long> allocations {0};
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+using bench_clock = std::chrono::steady_clock;
+
+template <typename Function>
+void measure(const std::string &name, long count, Function fn) {
+    long long allocated_before = allocations.load();
+    auto start = bench_clock::now();
+    fn();
+    std::chrono::duration<double, std::nano> elapsed = bench_clock::now() - start;
+    long long allocated = allocations.load() - allocated_before;
+    std::cout << "  " << std::setw(24) << std::left << name << std::right << std::setw(12)
+              << elapsed.count() / count << std::setw(14) << static_cast<double>(allocated) / count << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int steps = argc > 1 ? std::atoi(argv[1]) : 1000;
+    int trips = argc > 2 ? std::atoi(argv[2]) : 10000;
+
+    ThreadPool pool;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << pool.size() << " pool threads" << std::endl;
+
+    std::cout << "chain of " << steps << " steps      ns/step   allocs/step" << std::endl;
+    measure("then, inline", steps, [&] {
+        Promise<long> first;
+        Future<long> future = first.get_future();
+        for (int i{0}; i < steps; ++i) {
+            future = future.then([](long x) { return x + 1; });
+        }
+        first.set_value(0);
+        if (future.get() != steps) {
+            std::cerr << "wrong result" << std::endl;
+        }
+    });
+    measure("then, ThreadPool", steps, [&] {
+        Promise<long> first;
+        Future<long> future = first.get_future();
+        for (int i{0}; i < steps; ++i) {
+            future = future.then(pool, [](long x) { return x + 1; });
+        }
+        first.set_value(0);
+        if (future.get() != steps) {
+            std::cerr << "wrong result" << std::endl;
+        }
+    });
+    measure("std::async", steps, [&] {
+        std::promise<long> first;
+        std::future<long> future = first.get_future();
+        for (int i{0}; i < steps; ++i) {
+            future = std::async(std::launch::async, [previous = std::move(future)]() mutable {
+                return previous.get() + 1;
+            });
+        }
+        first.set_value(0);
+        if (future.get() != steps) {
+            std::cerr << "wrong result" << std::endl;
+        }
+    });
+
+    std::cout << "round trip                 ns/trip   allocs/trip" << std::endl;
+    measure("Promise/Future", trips, [&] {
+        for (int i{0}; i < trips; ++i) {
+            Promise<int> promise;
+            auto future = promise.get_future();
+            std::thread setter([&promise, i] { promise.set_value(i); });
+            future.get();
+            setter.join();
+        }
+    });
+    measure("std::promise/std::future", trips, [&] {
+        for (int i{0}; i < trips; ++i) {
+            std::promise<int> promise;
+            auto future = promise.get_future();
+            std::thread setter([&promise, i] { promise.set_value(i); });
+            future.get();
+            setter.join();
+        }
+    });
+
+    std::cout << "combinators (" << steps << " futures)  ns/future  allocs/future" << std::endl;
+    measure("when_all", steps, [&] {
+        std::vector<Future<int>> futures;
+        for (int i{0}; i < steps; ++i) {
+            futures.push_back(async_on(pool, [i] { return i; }));
+        }
+        auto values = when_all(std::move(futures)).get();
+        if (values.size() != static_cast<std::size_t>(steps)) {
+            std::cerr << "wrong result" << std::endl;
+        }
+    });
+    measure("when_any", steps, [&] {
+        std::vector<Future<int>> futures;
+        for (int i{0}; i < steps; ++i) {
+            futures.push_back(async_on(pool, [i] { return i; }));
+        }
+        when_any(std::move(futures)).get();
+    });
+    return 0;
+}
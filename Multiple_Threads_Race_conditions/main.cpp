@@ -3,6 +3,11 @@
 #include <vector>
 #include <string>
 #include <mutex>
+
+#include "concurrent_vector.h"
+#include "striped_counter.h"
+#include "deferred_counter.h"
+
 int global_int {0};
 void increment_int(int &global) {
     for (int i{0}; i < 100000; ++i) {
@@ -10,6 +15,22 @@ void increment_int(int &global) {
     }
     std::cout << global << std::endl;
 }
+
+// Same work as increment_int(), without the data race or a shared cache line
+StripedCounter<int> striped_int;
+void increment_striped() {
+    for (int i{0}; i < 100000; ++i) {
+        striped_int.add(1);
+    }
+}
+
+// Same again, adding into a thread_local total which is flushed every 1024 increments and at thread exit
+DeferredCounter<int> deferred_int;
+void increment_deferred() {
+    for (int i{0}; i < 100000; ++i) {
+        deferred_int.add(1);
+    }
+}
 void hello(int a) {
     std::cout << "hello from thread " << a << std::endl;
 }
@@ -44,6 +65,14 @@ void enter(std::vector<int> &vec1) {
     protect.unlock();
 }
 
+// enter() without the mutex: each thread appends its own numbers to one shared vector
+ConcurrentVector<int> shared_nums;
+void append_concurrent(const std::vector<int> &vec1) {
+    for (int num : vec1) {
+        shared_nums.push_back(num);
+    }
+}
+
 /*
  * Starting multiple threads
  * - We can start multiple threads
@@ -272,6 +301,125 @@ void enter(std::vector<int> &vec1) {
  *      - Increased program complexity
  *      */
 
+/*
+ * Counting from many threads (striped_counter.h)
+ * - A mutex or std::atomic<int> makes increment_int() correct
+ *      - But every increment still goes through one cache line
+ * - StripedCounter gives each thread its own padded cell
+ *      - add() is an uncontended relaxed increment
+ *      - read() adds up the cells
+ * - See increment_striped() and striped_counter_bench.cpp
+ *      */
+
+/*
+ * Memory orders (memory_order_bench.cpp)
+ * - The increment loop, timed with relaxed, acq_rel and seq_cst fetch_add, a CAS loop and a mutex
+ * - One shared counter, per-thread counters on the same cache line, and on separate lines
+ * - Reports ns per increment and cache misses per increment
+ *      */
+
+/*
+ * Parallel loops (parallel.h, thread_pool.h)
+ * - increment_int() parallelizes a loop by having every thread update one variable
+ * - parallel_for(begin, end, grain, fn) and parallel_reduce(...) split the range instead
+ *      - Each part is processed on a pool thread, with its own local total
+ *      - The totals are combined in a tree at the end
+ * - The pool's threads are started once, not once per loop
+ * - See parallel_reduce_bench.cpp
+ *      */
+
+/*
+ * Fibers (fiber.h)
+ * - hello(), hola() and bonjour() each use a whole kernel thread to print one line
+ * - FiberScheduler runs many fibers (user-space threads with small stacks) on a few kernel threads
+ *      - scheduler.spawn([] { hello(1); });
+ *      - this_fiber::yield() lets another fiber run
+ *      - FiberMutex suspends the fiber, not the kernel thread
+ * - See fiber_bench.cpp
+ *      */
+
+/*
+ * Delayed work (timer_wheel.h)
+ * - hello1(num) keeps a whole thread asleep just to print something later
+ * - TimerWheel keeps every pending timeout in one structure, driven by one thread
+ *      - auto id = wheel.schedule_after(std::chrono::seconds(num), [num] { ... });
+ *      - wheel.cancel(id) if it is no longer needed
+ *      - Due callbacks run on a ThreadPool
+ * - See timer_wheel_bench.cpp
+ *      */
+
+/*
+ * Appending from many threads (concurrent_vector.h)
+ * - enter() guards a std::vector with a mutex, and even its reads need the lock
+ *      - Its lock() is inside the loop and its unlock() after it, so a thread locks a mutex it already holds
+ * - ConcurrentVector grows by adding segments, so elements never move
+ *      - push_back() and grow_by() do not lock
+ *      - Elements below size() can be read while other threads append
+ * - See append_concurrent() and concurrent_vector_bench.cpp
+ *      */
+
+/*
+ * Work stealing (work_stealing.h)
+ * - practice1..3 each get their own std::thread, and the OS decides which one runs where
+ * - WorkStealingPool gives each worker thread its own deque of tasks
+ *      - The owner pushes and pops at one end, without atomic read-modify-writes
+ *      - Idle workers steal from the other end of a random worker's deque
+ * - StealingTaskGroup: run() spawns a task, wait() helps run tasks until they have finished
+ *      - Tasks can spawn and wait for their own tasks, e.g. recursive fib and quicksort
+ * - See work_stealing_bench.cpp
+ *      */
+
+/*
+ * Task graphs (task_graph.h)
+ * - main() orders the work with join(): every thread of one phase waits for every thread of the last
+ * - TaskGraph declares which task needs which instead
+ *      - auto a = graph.emplace(fn_a), b = graph.emplace(fn_b); graph.precede(a, b);
+ *      - graph.run(pool) starts each task as soon as its own predecessors have finished
+ *      - The same graph can be run again without rebuilding it
+ * - See task_graph_bench.cpp
+ *      */
+
+/*
+ * Futures (future.h)
+ * - The threads return their results through globals like global_int, with a mutex
+ * - Promise<T> / Future<T> pass one result from one thread to another
+ *      - future.then(fn) runs fn on the result when it arrives, and gives a Future for fn's result
+ *      - then(pool, fn) runs it on a ThreadPool instead of inline
+ *      - when_all(futures), when_any(futures), async_on(pool, fn)
+ * - One allocation per future, and no lock unless get() has to wait
+ * - See future_bench.cpp
+ *      */
+
+/*
+ * Parallel algorithms (parallel_algorithms.h)
+ * - In enter(), every thread walks the whole of nums; nobody divides up the work
+ * - parallel_for_each, parallel_transform, parallel_inclusive_scan, parallel_copy_if and parallel_sort
+ *      - Each splits the range into parts for the ThreadPool, like std::execution::par without TBB
+ *      - Scan and copy_if make two passes: totals per part first, then the output
+ *      - Sort: std::sort per chunk, then parallel merges
+ * - See parallel_algorithms_bench.cpp
+ *      */
+
+/*
+ * CPU topology and pinning (common/topology.h)
+ * - The threads in main() run on whichever CPU the kernel picks, and can move
+ * - CpuTopology::system() reads the CPUs, cores, packages, NUMA nodes and caches from /sys
+ * - ThreadPlacement(policy).launch(i, fn) starts thread i pinned to a CPU
+ *      - compact, scatter, one_per_core, avoid_smt
+ *      - Linux only; elsewhere the threads are not pinned
+ * - See striped_counter_bench.cpp, and synchronized_bench.cpp in Multiple_Reader_one_writer
+ *      */
+
+/*
+ * DeferredCounter (deferred_counter.h)
+ * - StripedCounter still does one atomic increment per add()
+ * - DeferredCounter adds into a thread_local accumulator, and only flushes it into the shared total
+ *      - every N adds, after T microseconds, on flush(), or when the thread exits
+ * - read() is the flushed total: behind by at most N per thread which is still adding
+ * - read_all() adds the accumulators too: exact once the threads have stopped
+ * - See increment_deferred() and deferred_counter_bench.cpp
+ *      */
+
 
 
 int main() {
@@ -316,6 +464,20 @@ int main() {
 //    std::cout << num1 << std::endl;
 
     std::vector<int> nums{1,2,3,4,5,6};
+
+    // enter() without the mutex: three threads append to one ConcurrentVector.
+    // Runs first, as enter() locks protect again while holding it and never returns
+    std::thread append1(append_concurrent, std::cref(nums));
+    std::thread append2(append_concurrent, std::cref(nums));
+    std::thread append3(append_concurrent, std::cref(nums));
+
+    append1.join(); append2.join(); append3.join();
+
+    for (int num : shared_nums) {
+        std::cout << num;
+    }
+    std::cout << std::endl;
+
     std::thread practice1(enter, std::ref(nums));
     std::thread practice2(enter, std::ref(nums));
     std::thread practice3(enter, std::ref(nums));
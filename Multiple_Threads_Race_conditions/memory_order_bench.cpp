@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Memory order benchmark
+ * - The increment loop from increment_int(), done in different ways
+ *      - fetch_add with memory_order_relaxed, acq_rel and seq_cst
+ *      - a compare_exchange_weak() loop
+ *      - load, then store (not a read-modify-write - only correct if no other thread uses the counter)
+ *      - an int protected by std::mutex
+ *
+ * - Where the counters are
+ *      - shared: every thread increments the same counter
+ *      - same line: each thread has its own counter, but they are next to each other in memory
+ *        (false sharing - the cache line still moves between cores)
+ *      - separate lines: each thread's counter is on its own 64-byte cache line
+ *
+ * - Reported per operation
+ *      - ns: wall-clock time divided by the number of increments each thread made
+ *      - cache misses: from the CPU's performance counters (Linux perf_event_open)
+ *        "n/a" where the counters are not available, e.g. in a container or on macOS
+ *
+ * - On x86, every read-modify-write is a locked instruction, so relaxed, acq_rel and seq_cst cost the same
+ *      - They differ on ARM, where relaxed needs no barrier
+ *
+ * Usage: memory_order_bench [max threads] [increments per thread]
+ *      */
+
+// Counts cache misses in this thread and every thread it starts afterwards
+class CacheMissCounter {
+public:
+    CacheMissCounter() {
+#if defined(__linux__)
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    ~CacheMissCounter() {
+#if defined(__linux__)
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    CacheMissCounter(const CacheMissCounter &source) = delete;
+    CacheMissCounter &operator=(const CacheMissCounter &source) = delete;
+
+    bool available() const { return fd >= 0; }
+
+    void start() {
+#if defined(__linux__)
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Call after the threads have been joined: their counts are added in when they exit
+    long long stop() {
+        long long count {-1};
+#if defined(__linux__)
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+                count = -1;
+            }
+        }
+#endif
+        return count;
+    }
+
+private:
+    int fd {-1};
+};
+
+enum class Placement { shared, same_line, separate_lines };
+
+const char *placement_name(Placement placement) {
+    switch (placement) {
+        case Placement::shared: return "shared counter";
+        case Placement::same_line: return "same line";
+        default: return "separate lines";
+    }
+}
+
+struct MutexInt {
+    std::mutex mut;
+    int value {0};
+};
+
+// One Cell per thread, laid out according to the placement
+template <typename Cell>
+class Cells {
+public:
+    Cells(unsigned nthreads, Placement placement) : count(placement == Placement::shared ? 1 : nthreads) {
+        stride = placement == Placement::separate_lines ? round_up(sizeof(Cell), 64) : sizeof(Cell);
+        memory = static_cast<char *>(::operator new(stride * count, std::align_val_t(64)));
+        for (unsigned i{0}; i < count; ++i) {
+            new (memory + i * stride) Cell();
+        }
+    }
+
+    ~Cells() {
+        for (unsigned i{0}; i < count; ++i) {
+            at(i).~Cell();
+        }
+        ::operator delete(memory, std::align_val_t(64));
+    }
+
+    Cells(const Cells &source) = delete;
+    Cells &operator=(const Cells &source) = delete;
+
+    Cell &at(unsigned thread) { return *reinterpret_cast<Cell *>(memory + (thread % count) * stride); }
+
+private:
+    static std::size_t round_up(std::size_t n, std::size_t multiple) { return (n + multiple - 1) / multiple * multiple; }
+
+    unsigned count;
+    std::size_t stride;
+    char *memory;
+};
+
+struct Result {
+    double ns_per_op;
+    double misses_per_op;
+};
+
+template <typename Cell, typename Increment>
+Result run(unsigned nthreads, int increments, Placement placement, Increment increment) {
+    Cells<Cell> cells(nthreads, placement);
+    CacheMissCounter misses;
+    std::atomic<bool> start {false};
+    std::atomic<unsigned> ready {0};
+    std::vector<std::thread> threads;
+
+    misses.start();
+    for (unsigned t{0}; t < nthreads; ++t) {
+        threads.push_back(std::thread([&, t] {
+            Cell &cell = cells.at(t);
+            ready.fetch_add(1);
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (int i{0}; i < increments; ++i) {
+                increment(cell);
+            }
+        }));
+    }
+    while (ready.load() < nthreads) {
+        std::this_thread::yield();
+    }
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - begin;
+    auto miss_count = misses.stop();
+    double total_ops = static_cast<double>(nthreads) * increments;
+    return {elapsed.count() / increments, miss_count < 0 ? -1.0 : miss_count / total_ops};
+}
+
+void print(Result result) {
+    std::cout << std::setw(10) << result.ns_per_op;
+    if (result.misses_per_op < 0) {
+        std::cout << std::setw(8) << "n/a";
+    }
+    else {
+        std::cout << std::setw(8) << result.misses_per_op;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned max_threads = argc > 1 ? std::atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+    int increments = argc > 2 ? std::atoi(argv[2]) : 2000000;
+
+    std::vector<unsigned> thread_counts;
+    for (unsigned n{1}; n <= max_threads; n *= 2) {
+        thread_counts.push_back(n);
+    }
+
+    using Counter = std::atomic<int>;
+    auto relaxed = [](Counter &c) { c.fetch_add(1, std::memory_order_relaxed); };
+    auto acq_rel = [](Counter &c) { c.fetch_add(1, std::memory_order_acq_rel); };
+    auto seq_cst = [](Counter &c) { c.fetch_add(1, std::memory_order_seq_cst); };
+    auto cas_loop = [](Counter &c) {
+        int expected = c.load(std::memory_order_relaxed);
+        while (!c.compare_exchange_weak(expected, expected + 1, std::memory_order_relaxed)) {
+        }
+    };
+    auto load_store = [](Counter &c) { c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); };
+    auto with_mutex = [](MutexInt &c) {
+        std::lock_guard<std::mutex> lck_guard(c.mut);
+        ++c.value;
+    };
+
+    std::cout << increments << " increments per thread; each column is ns/op, cache misses/op" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (auto placement : {Placement::shared, Placement::same_line, Placement::separate_lines}) {
+        std::cout << std::endl << placement_name(placement) << std::endl;
+        std::cout << std::setw(14) << std::left << "threads" << std::right;
+        for (auto n : thread_counts) {
+            std::cout << std::setw(18) << n;
+        }
+        std::cout << std::endl;
+
+        auto row = [&](const char *name, auto measure) {
+            std::cout << std::setw(14) << std::left << name << std::right;
+            for (auto n : thread_counts) {
+                print(measure(n));
+            }
+            std::cout << std::endl;
+        };
+        row("relaxed", [&](unsigned n) { return run<Counter>(n, increments, placement, relaxed); });
+        row("acq_rel", [&](unsigned n) { return run<Counter>(n, increments, placement, acq_rel); });
+        row("seq_cst", [&](unsigned n) { return run<Counter>(n, increments, placement, seq_cst); });
+        row("CAS loop", [&](unsigned n) { return run<Counter>(n, increments, placement, cas_loop); });
+        if (placement != Placement::shared) {
+            row("load+store", [&](unsigned n) { return run<Counter>(n, increments, placement, load_store); });
+        }
+        row("mutex", [&](unsigned n) { return run<MutexInt>(n, increments, placement, with_mutex); });
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#ifndef MULTIPLE_THREADS_RACE_CONDITIONS_PARALLEL_H
+#define MULTIPLE_THREADS_RACE_CONDITIONS_PARALLEL_H
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "thread_pool.h"
+
+/*
+ * parallel_for and parallel_reduce
+ * - increment_int() has every thread update one shared variable
+ *      - The threads queue up on it (or lose updates, without a mutex)
+ *
+ * - Here, every thread works on its own part of the range
+ *      - The range is split in half, and in half again, until the parts are "grain" long
+ *      - One half is handed to the pool, the other is processed by the splitting thread
+ *      - No thread writes to memory which another thread is writing
+ *
+ * - parallel_for(begin, end, grain, fn) calls fn(i) for every i in [begin, end)
+ *
+ * - parallel_reduce(begin, end, grain, identity, body, combine)
+ *      - body(sub_begin, sub_end, identity) reduces one part, in a local variable
+ *      - combine(left, right) joins the results of two halves
+ *      - The results are combined in a tree, the same shape as the splitting
+ *
+ * - parallel_reduce(first, last, identity, op) reduces the elements of an iterator range with op
+ *      - op must be associative: the elements are not combined left to right
+ *
+ * - grain 0 picks a grain which gives each pool thread about eight parts
+ *      */
+
+namespace parallel_detail {
+    template <typename Index>
+    Index default_grain(Index begin, Index end, ThreadPool &pool) {
+        Index parts = static_cast<Index>(pool.size() * 8);
+        return std::max(static_cast<Index>(1), static_cast<Index>((end - begin) / parts));
+    }
+
+    template <typename Index, typename Function>
+    void for_range(Index begin, Index end, Index grain, Function &fn, ThreadPool &pool) {
+        if (end - begin <= grain) {
+            for (Index i{begin}; i < end; ++i) {
+                fn(i);
+            }
+            return;
+        }
+        Index middle = begin + (end - begin) / 2;
+        TaskGroup group(pool);
+        group.run([=, &fn, &pool] { for_range(begin, middle, grain, fn, pool); });
+        for_range(middle, end, grain, fn, pool);
+        group.wait();
+    }
+
+    template <typename Index, typename T, typename Body, typename Combine>
+    T reduce_range(Index begin, Index end, Index grain, const T &identity, Body &body, Combine &combine,
+                   ThreadPool &pool) {
+        if (end - begin <= grain) {
+            return body(begin, end, identity);
+        }
+        Index middle = begin + (end - begin) / 2;
+        T left {identity};
+        TaskGroup group(pool);
+        group.run([=, &left, &identity, &body, &combine, &pool] {
+            left = reduce_range(begin, middle, grain, identity, body, combine, pool);
+        });
+        T right = reduce_range(middle, end, grain, identity, body, combine, pool);
+        group.wait();
+        return combine(std::move(left), std::move(right));
+    }
+}
+
+template <typename Index, typename Function>
+void parallel_for(Index begin, Index end, Index grain, Function fn, ThreadPool &pool = default_pool()) {
+    if (begin >= end) {
+        return;
+    }
+    if (grain <= 0) {
+        grain = parallel_detail::default_grain(begin, end, pool);
+    }
+    parallel_detail::for_range(begin, end, grain, fn, pool);
+}
+
+template <typename Index, typename T, typename Body, typename Combine>
+T parallel_reduce(Index begin, Index end, Index grain, T identity, Body body, Combine combine,
+                  ThreadPool &pool = default_pool()) {
+    if (begin >= end) {
+        return identity;
+    }
+    if (grain <= 0) {
+        grain = parallel_detail::default_grain(begin, end, pool);
+    }
+    return parallel_detail::reduce_range(begin, end, grain, identity, body, combine, pool);
+}
+
+template <typename RandomIt, typename T, typename Op>
+T parallel_reduce(RandomIt first, RandomIt last, T identity, Op op, ThreadPool &pool = default_pool()) {
+    using Index = typename std::iterator_traits<RandomIt>::difference_type;
+    auto body = [first, &op](Index begin, Index end, T acc) {
+        for (Index i{begin}; i < end; ++i) {
+            acc = op(std::move(acc), first[i]);
+        }
+        return acc;
+    };
+    return parallel_reduce(Index{0}, last - first, Index{0}, std::move(identity), body, op, pool);
+}
+
+#endif //MULTIPLE_THREADS_RACE_CONDITIONS_PARALLEL_H
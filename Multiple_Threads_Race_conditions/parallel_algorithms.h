@@ -0,0 +1,214 @@
+#ifndef MULTIPLE_THREADS_RACE_CONDITIONS_PARALLEL_ALGORITHMS_H
+#define MULTIPLE_THREADS_RACE_CONDITIONS_PARALLEL_ALGORITHMS_H
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "parallel.h"
+
+/*
+ * Parallel algorithms
+ * - enter() has three threads walk the same vector, each doing all of the work
+ * - These split a range between the pool threads, like the std algorithms with std::execution::par,
+ *   but on this project's ThreadPool, so they do not need TBB
+ *      - Random access iterators only; the output must not overlap the input
+ *
+ * - parallel_for_each(first, last, fn)
+ * - parallel_transform(first, last, d_first, op) - returns the end of the output
+ *
+ * - parallel_inclusive_scan(first, last, d_first, op = std::plus)
+ *      - Each output is op(all the inputs up to and including it)
+ *      - Splits the range into blocks; pass 1 reduces each block, then the block totals are
+ *        scanned on one thread, and pass 2 scans each block starting from the total before it
+ *      - op must be associative; it is applied about twice as often as by std::inclusive_scan
+ *
+ * - parallel_copy_if(first, last, d_first, pred) - keeps the order, returns the end of the output
+ *      - Pass 1 counts the matches in each block, which gives each block its place in the output,
+ *        pass 2 copies; pred is called twice for each element, so it must give the same answer
+ *
+ * - parallel_sort(first, last, comp = std::less)
+ *      - Sorts one chunk per task with std::sort, then merges pairs of chunks, round after round
+ *      - Each merge is split into pieces by binary search ("merge path"), so that even the last
+ *        round, one merge of two halves, keeps every thread busy
+ *      - Merges into a temporary buffer the size of the range, so the elements must be
+ *        default constructible and movable; not stable
+ *      */
+
+namespace parallel_detail {
+    // Blocks for the two-pass algorithms: a few per pool thread
+    template <typename Index>
+    Index block_count(Index n, ThreadPool &pool) {
+        return std::max(Index{1}, std::min(n, static_cast<Index>(pool.size() * 4)));
+    }
+
+    // Where output element k comes from, in a merge of [a, a + na) and [b, b + nb):
+    // the number of elements taken from a; on ties a comes first
+    template <typename It, typename Index, typename Compare>
+    Index merge_path(It a, Index na, It b, Index nb, Index k, Compare &comp) {
+        Index lo = std::max(Index{0}, k - nb);
+        Index hi = std::min(k, na);
+        while (lo < hi) {
+            Index mid = lo + (hi - lo) / 2;
+            if (!comp(b[k - mid - 1], a[mid])) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+}
+
+template <typename RandomIt, typename Function>
+void parallel_for_each(RandomIt first, RandomIt last, Function fn, ThreadPool &pool = default_pool()) {
+    using Index = typename std::iterator_traits<RandomIt>::difference_type;
+    parallel_for(Index{0}, last - first, Index{0}, [first, &fn](Index i) { fn(first[i]); }, pool);
+}
+
+template <typename RandomIt, typename OutputIt, typename UnaryOp>
+OutputIt parallel_transform(RandomIt first, RandomIt last, OutputIt d_first, UnaryOp op,
+                            ThreadPool &pool = default_pool()) {
+    using Index = typename std::iterator_traits<RandomIt>::difference_type;
+    parallel_for(Index{0}, last - first, Index{0}, [first, d_first, &op](Index i) { d_first[i] = op(first[i]); }, pool);
+    return d_first + (last - first);
+}
+
+template <typename RandomIt, typename OutputIt, typename BinaryOp = std::plus<>>
+OutputIt parallel_inclusive_scan(RandomIt first, RandomIt last, OutputIt d_first, BinaryOp op = BinaryOp(),
+                                 ThreadPool &pool = default_pool()) {
+    using Index = typename std::iterator_traits<RandomIt>::difference_type;
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    Index n = last - first;
+    if (n == 0) {
+        return d_first;
+    }
+    Index nblocks = parallel_detail::block_count(n, pool);
+    auto block_begin = [n, nblocks](Index b) { return n * b / nblocks; };
+
+    // Pass 1: the total of each block but the last
+    std::vector<T> totals(nblocks);
+    parallel_for(Index{0}, nblocks - 1, Index{1}, [&](Index b) {
+        T acc = first[block_begin(b)];
+        for (Index i = block_begin(b) + 1; i < block_begin(b + 1); ++i) {
+            acc = op(std::move(acc), first[i]);
+        }
+        totals[b] = std::move(acc);
+    }, pool);
+    // Turn them into the total of everything before each block (block 0 has none)
+    for (Index b{1}; b < nblocks - 1; ++b) {
+        totals[b] = op(totals[b - 1], totals[b]);
+    }
+
+    // Pass 2
+    parallel_for(Index{0}, nblocks, Index{1}, [&](Index b) {
+        Index i = block_begin(b);
+        T acc = b == 0 ? T(first[i]) : op(totals[b - 1], first[i]);
+        d_first[i] = acc;
+        for (++i; i < block_begin(b + 1); ++i) {
+            acc = op(std::move(acc), first[i]);
+            d_first[i] = acc;
+        }
+    }, pool);
+    return d_first + n;
+}
+
+template <typename RandomIt, typename OutputIt, typename Predicate>
+OutputIt parallel_copy_if(RandomIt first, RandomIt last, OutputIt d_first, Predicate pred,
+                          ThreadPool &pool = default_pool()) {
+    using Index = typename std::iterator_traits<RandomIt>::difference_type;
+    Index n = last - first;
+    if (n == 0) {
+        return d_first;
+    }
+    Index nblocks = parallel_detail::block_count(n, pool);
+    auto block_begin = [n, nblocks](Index b) { return n * b / nblocks; };
+
+    // offsets[b + 1] = matches in block b, then the prefix sums give each block's place in the output
+    std::vector<Index> offsets(nblocks + 1);
+    parallel_for(Index{0}, nblocks, Index{1}, [&](Index b) {
+        Index count {0};
+        for (Index i = block_begin(b); i < block_begin(b + 1); ++i) {
+            count += pred(first[i]) ? 1 : 0;
+        }
+        offsets[b + 1] = count;
+    }, pool);
+    for (Index b{1}; b <= nblocks; ++b) {
+        offsets[b] += offsets[b - 1];
+    }
+
+    parallel_for(Index{0}, nblocks, Index{1}, [&](Index b) {
+        OutputIt out = d_first + offsets[b];
+        for (Index i = block_begin(b); i < block_begin(b + 1); ++i) {
+            if (pred(first[i])) {
+                *out++ = first[i];
+            }
+        }
+    }, pool);
+    return d_first + offsets[nblocks];
+}
+
+template <typename RandomIt, typename Compare = std::less<>>
+void parallel_sort(RandomIt first, RandomIt last, Compare comp = Compare(), ThreadPool &pool = default_pool()) {
+    using Index = typename std::iterator_traits<RandomIt>::difference_type;
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    Index n = last - first;
+    // Chunks: a power of two, about two per pool thread
+    Index nchunks {1};
+    while (nchunks < static_cast<Index>(pool.size()) * 2) {
+        nchunks *= 2;
+    }
+    if (pool.size() == 1 || n < nchunks * 4096) {
+        std::sort(first, last, comp);
+        return;
+    }
+    auto chunk_begin = [n, nchunks](Index c) { return n * c / nchunks; };
+
+    parallel_for(Index{0}, nchunks, Index{1}, [&](Index c) {
+        std::sort(first + chunk_begin(c), first + chunk_begin(c + 1), comp);
+    }, pool);
+
+    // Merge runs of "width" chunks into runs of 2 * width, between the range and the buffer
+    // new T[n] leaves a trivial T uninitialized: std::vector would zero it on this thread first.
+    // The first merge round writes every element, in parallel
+    std::unique_ptr<T[]> buffer(new T[n]);
+    bool in_buffer {false};
+    for (Index width{1}; width < nchunks; width *= 2) {
+        // nchunks / (2 * width) merges, each split into 2 * width pieces: always nchunks tasks
+        Index pieces_per_merge = 2 * width;
+        auto merge_piece = [&](auto source, auto target, Index task) {
+            Index merge = task / pieces_per_merge;
+            Index piece = task % pieces_per_merge;
+            Index begin = chunk_begin(merge * 2 * width);
+            Index middle = chunk_begin(merge * 2 * width + width);
+            Index end = chunk_begin((merge + 1) * 2 * width);
+            Index na = middle - begin, nb = end - middle;
+            Index k_begin = (na + nb) * piece / pieces_per_merge;
+            Index k_end = (na + nb) * (piece + 1) / pieces_per_merge;
+            Index i_begin = parallel_detail::merge_path(source + begin, na, source + middle, nb, k_begin, comp);
+            Index i_end = parallel_detail::merge_path(source + begin, na, source + middle, nb, k_end, comp);
+            std::merge(std::make_move_iterator(source + begin + i_begin), std::make_move_iterator(source + begin + i_end),
+                       std::make_move_iterator(source + middle + (k_begin - i_begin)),
+                       std::make_move_iterator(source + middle + (k_end - i_end)),
+                       target + begin + k_begin, comp);
+        };
+        parallel_for(Index{0}, nchunks, Index{1}, [&](Index task) {
+            if (in_buffer) {
+                merge_piece(buffer.get(), first, task);
+            }
+            else {
+                merge_piece(first, buffer.get(), task);
+            }
+        }, pool);
+        in_buffer = !in_buffer;
+    }
+    if (in_buffer) {
+        parallel_for(Index{0}, n, Index{0}, [&](Index i) { first[i] = std::move(buffer[i]); }, pool);
+    }
+}
+
+#endif //MULTIPLE_THREADS_RACE_CONDITIONS_PARALLEL_ALGORITHMS_H
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parallel_algorithms.h"
+
+/*
+ * Parallel algorithms benchmark: scaling from 1 thread to every hardware thread
+ * - for_each (x = x * 3 + 1 in place), transform (x * x into a second vector), inclusive_scan (+),
+ *   copy_if (odd elements) and sort, on a vector of random unsigned ints
+ *      - unsigned, so that the scan can wrap around without undefined behaviour
+ * - The serial column is the std algorithm; the others are the parallel_ version on a ThreadPool
+ *   with 1, 2, 4... threads, and its speedup over serial
+ * - Every parallel result is checked against the serial one
+ *
+ * - The default is 10^8 elements, which needs about 1.6 GB
+ *
+ * Usage: parallel_algorithms_bench [number of elements] [max threads]
+ *      */
+
+using bench_clock = std::chrono::steady_clock;
+
+template <typename Function>
+double seconds(Function fn) {
+    auto start = bench_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed = bench_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+    long count = argc > 1 ? std::atol(argv[1]) : 100000000L;
+    unsigned max_threads = argc > 2 ? std::atoi(argv[2]) : std::thread::hardware_concurrency();
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+
+    std::vector<unsigned> data(count);
+    std::mt19937 gen(42);
+    for (auto &value : data) {
+        value = gen();
+    }
+    std::vector<unsigned> expected(count);
+    std::vector<unsigned> output(count);
+
+    std::vector<unsigned> thread_counts;
+    for (unsigned t{1}; t < max_threads; t *= 2) {
+        thread_counts.push_back(t);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::cout << count << " elements" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::setw(18) << "serial s";
+    for (auto t : thread_counts) {
+        std::cout << std::setw(9) << t << " thr" << std::setw(8) << "x";
+    }
+    std::cout << std::endl;
+
+    auto odd = [](unsigned x) { return (x & 1) != 0; };
+    auto square = [](unsigned x) { return x * x; };
+    auto bump = [](unsigned &x) { x = x * 3 + 1; };
+
+    // Runs the serial version into "expected", then the parallel one into "output" for each pool size
+    // "copy" selects the in-place algorithms, whose input is copied into place before the clock starts
+    // The others get an output of "count" elements again (copy_if shrinks it), also before the clock starts
+    auto row = [&](const std::string &name, bool copy, auto serial, auto parallel) {
+        if (copy) {
+            expected = data;
+        }
+        double serial_s = seconds([&] { serial(); });
+        std::cout << std::setw(10) << std::left << name << std::right << std::setw(8) << serial_s;
+        for (auto t : thread_counts) {
+            ThreadPool pool(t);
+            if (copy) {
+                output = data;
+            }
+            else {
+                output.resize(count);
+            }
+            double parallel_s = seconds([&] { parallel(pool); });
+            std::cout << std::setw(13) << parallel_s << std::setw(8) << serial_s / parallel_s;
+            if (output != expected) {
+                std::cout << std::endl;
+                std::cerr << name << " with " << t << " threads gave a different result" << std::endl;
+                std::exit(1);
+            }
+        }
+        std::cout << std::endl;
+    };
+
+    row("for_each", true,
+        [&] { std::for_each(expected.begin(), expected.end(), bump); },
+        [&](ThreadPool &pool) { parallel_for_each(output.begin(), output.end(), bump, pool); });
+    row("transform", false,
+        [&] { std::transform(data.begin(), data.end(), expected.begin(), square); },
+        [&](ThreadPool &pool) { parallel_transform(data.begin(), data.end(), output.begin(), square, pool); });
+    row("scan", false,
+        [&] { std::inclusive_scan(data.begin(), data.end(), expected.begin()); },
+        [&](ThreadPool &pool) {
+            parallel_inclusive_scan(data.begin(), data.end(), output.begin(), std::plus<>(), pool);
+        });
+    row("copy_if", false,
+        [&] { expected.erase(std::copy_if(data.begin(), data.end(), expected.begin(), odd), expected.end()); },
+        [&](ThreadPool &pool) {
+            output.erase(parallel_copy_if(data.begin(), data.end(), output.begin(), odd, pool), output.end());
+        });
+    row("sort", true,
+        [&] { std::sort(expected.begin(), expected.end()); },
+        [&](ThreadPool &pool) { parallel_sort(output.begin(), output.end(), std::less<>(), pool); });
+    return 0;
+}
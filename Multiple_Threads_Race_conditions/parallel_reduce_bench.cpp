@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parallel.h"
+
+/*
+ * parallel_reduce benchmark: add up a vector of ints
+ * - single thread: one loop, one local total
+ * - shared counter: the vector is split between threads, every element is added to one std::atomic
+ *      - The increment_int() approach, made correct
+ * - parallel_reduce: recursive splitting on the default pool, local totals combined in a tree
+ *
+ * - The vector is filled with parallel_for
+ * - First, parallel_for and parallel_reduce with grain 1 on a 4 thread pool are checked
+ *      - Every element is its own part, so the task groups nest as deep as they can
+ * - The default is 10^9 ints, which needs 4 GB
+ *
+ * Usage: parallel_reduce_bench [number of ints] [threads for the shared counter]
+ *      */
+
+template <typename Function>
+long long timed(const std::string &name, double gigabytes, Function fn) {
+    auto start = std::chrono::steady_clock::now();
+    long long result = fn();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << std::setw(18) << std::left << name << std::right << std::setw(10) << elapsed.count() << " s"
+              << std::setw(10) << gigabytes / elapsed.count() << " GB/s" << std::setw(22) << result << std::endl;
+    return result;
+}
+
+bool grain_one_works() {
+    const long count {200000};
+    ThreadPool pool(4);
+    std::vector<int> seen(count);
+    parallel_for(0L, count, 1L, [&seen](long i) { ++seen[i]; }, pool);
+    auto sum = parallel_reduce(0L, count, 1L, 0LL, [](long begin, long end, long long acc) {
+        for (long i{begin}; i < end; ++i) {
+            acc += i;
+        }
+        return acc;
+    }, std::plus<long long>(), pool);
+    return std::all_of(seen.begin(), seen.end(), [](int n) { return n == 1; }) &&
+           sum == static_cast<long long>(count) * (count - 1) / 2;
+}
+
+int main(int argc, char *argv[]) {
+    long long count = argc > 1 ? std::atoll(argv[1]) : 1000000000LL;
+    unsigned nthreads = argc > 2 ? std::atoi(argv[2]) : std::max(2u, std::thread::hardware_concurrency());
+
+    if (!grain_one_works()) {
+        std::cerr << "grain 1 parallel_for or parallel_reduce is wrong" << std::endl;
+        return 1;
+    }
+
+    std::vector<int> data(count);
+    parallel_for(0LL, count, 0LL, [&data](long long i) { data[i] = static_cast<int>(i % 100); });
+    double gigabytes = count * sizeof(int) / 1e9;
+
+    std::cout << count << " ints, " << default_pool().size() << " pool threads" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+
+    auto expected = timed("single thread", gigabytes, [&] {
+        long long total {0};
+        for (auto value : data) {
+            total += value;
+        }
+        return total;
+    });
+
+    auto shared = timed("shared counter", gigabytes, [&] {
+        std::atomic<long long> total {0};
+        std::vector<std::thread> threads;
+        for (unsigned t{0}; t < nthreads; ++t) {
+            threads.push_back(std::thread([&, t] {
+                long long begin = count * t / nthreads;
+                long long end = count * (t + 1) / nthreads;
+                for (long long i{begin}; i < end; ++i) {
+                    total.fetch_add(data[i], std::memory_order_relaxed);
+                }
+            }));
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        return total.load();
+    });
+
+    auto reduced = timed("parallel_reduce", gigabytes, [&] {
+        return parallel_reduce(data.begin(), data.end(), 0LL, std::plus<long long>());
+    });
+
+    if (shared != expected || reduced != expected) {
+        std::cerr << "totals differ" << std::endl;
+        return 1;
+    }
+    return 0;
+}
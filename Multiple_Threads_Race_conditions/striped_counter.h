@@ -0,0 +1,94 @@
+#ifndef MULTIPLE_THREADS_RACE_CONDITIONS_STRIPED_COUNTER_H
+#define MULTIPLE_THREADS_RACE_CONDITIONS_STRIPED_COUNTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/*
+ * StripedCounter
+ * - increment_int() has many threads incrementing one int
+ *      - Without synchronization, increments are lost (data race)
+ *      - With a mutex, or std::atomic<int>, every increment goes through the same cache line
+ *      - That cache line moves from core to core on every increment
+ *
+ * - StripedCounter splits the count into "stripes"
+ *      - Each stripe is on its own cache line
+ *      - Each thread is given a stripe the first time it calls add()
+ *      - add() is one relaxed fetch_add on the thread's own stripe
+ *
+ * - read() adds up all the stripes
+ *      - Much slower than add(), so use it to read the total, not on every increment
+ *      - If other threads are still adding, the result is between the totals at the start and
+ *        at the end of the call (when every add() is positive)
+ *
+ * - With more threads than stripes, some threads share a stripe
+ *      - Still correct, because add() is an atomic read-modify-write
+ *      - The default is one stripe per hardware thread, rounded up to a power of two
+ *      */
+
+namespace striped_detail {
+    // Each thread gets the next number, the first time it asks
+    inline std::atomic<std::size_t> next_thread_slot {0};
+
+    inline std::size_t this_thread_slot() {
+        thread_local std::size_t slot = next_thread_slot.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    inline std::size_t round_up_to_power_of_two(std::size_t n) {
+        std::size_t power {1};
+        while (power < n) {
+            power *= 2;
+        }
+        return power;
+    }
+}
+
+template <typename T = long long>
+class StripedCounter {
+public:
+    explicit StripedCounter(std::size_t nstripes = std::thread::hardware_concurrency())
+        : stripes(striped_detail::round_up_to_power_of_two(nstripes == 0 ? 1 : nstripes)),
+          mask(stripes.size() - 1) {}
+
+    StripedCounter(const StripedCounter &source) = delete;
+    StripedCounter &operator=(const StripedCounter &source) = delete;
+
+    void add(T n = 1) {
+        stripes[striped_detail::this_thread_slot() & mask].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    StripedCounter &operator++() {
+        add(1);
+        return *this;
+    }
+
+    T read() const {
+        T total {0};
+        for (auto &stripe : stripes) {
+            total += stripe.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    // Only when no thread is adding
+    void reset() {
+        for (auto &stripe : stripes) {
+            stripe.value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t stripe_count() const { return stripes.size(); }
+
+private:
+    struct alignas(64) Stripe {
+        std::atomic<T> value {0};
+    };
+
+    std::vector<Stripe> stripes;
+    std::size_t mask;
+};
+
+#endif //MULTIPLE_THREADS_RACE_CONDITIONS_STRIPED_COUNTER_H
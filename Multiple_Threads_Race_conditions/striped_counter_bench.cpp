@@ -0,0 +1,109 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "striped_counter.h"
+#include "topology.h"
+
+/*
+ * StripedCounter benchmark
+ * - Like increment_int(): every thread increments one shared counter many times
+ * - From 1 thread up to 64
+ *
+ * - mutex: an int protected by std::mutex
+ * - atomic: std::atomic<int>::fetch_add
+ * - striped: StripedCounter<int>::add(), read() once at the end
+ *
+ * - Every run checks that the total is nthreads * increments
+ *
+ * - One table for each pin policy (common/topology.h); "none" lets the kernel place the threads
+ *      - With more threads than CPUs, the pinned threads share CPUs in policy order
+ *
+ * Usage: striped_counter_bench [max threads] [increments per thread] [policies, e.g. none,compact,scatter]
+ *      */
+
+// Runs increment() "increments" times on each of nthreads threads, returns millions of increments per second
+template <typename Increment>
+double mops(const ThreadPlacement &placement, unsigned nthreads, int increments, Increment increment) {
+    std::atomic<bool> start {false};
+    std::vector<std::thread> threads;
+    for (unsigned t{0}; t < nthreads; ++t) {
+        threads.push_back(placement.launch(t, [&] {
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (int i{0}; i < increments; ++i) {
+                increment();
+            }
+        }));
+    }
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return static_cast<double>(nthreads) * increments / elapsed.count() / 1e6;
+}
+
+void check(const std::string &name, long long total, long long expected) {
+    if (total != expected) {
+        std::cerr << name << ": total " << total << ", expected " << expected << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned max_threads = argc > 1 ? std::atoi(argv[1]) : 64;
+    int increments = argc > 2 ? std::atoi(argv[2]) : 1000000;
+    std::stringstream policy_names(argc > 3 ? argv[3] : "none,compact,scatter");
+
+    CpuTopology::system().describe(std::cout);
+    std::cout << std::endl;
+
+    std::string name;
+    while (std::getline(policy_names, name, ',')) {
+        PinPolicy policy;
+        if (!pin_policy_from_name(name, policy)) {
+            std::cerr << "unknown pin policy " << name << std::endl;
+            return 1;
+        }
+        ThreadPlacement placement(policy);
+
+        std::cout << std::endl << "pin policy " << name << ": millions of increments per second, " << increments
+                  << " per thread" << std::endl;
+        std::cout << std::setw(8) << "threads" << std::setw(12) << "mutex" << std::setw(12) << "atomic"
+                  << std::setw(12) << "striped" << std::endl;
+        std::cout << std::fixed << std::setprecision(1);
+
+        for (unsigned n{1}; n <= max_threads; n *= 2) {
+            long long expected = static_cast<long long>(n) * increments;
+
+            std::mutex mut;
+            int mutex_int {0};
+            auto mutex_mops = mops(placement, n, increments, [&] {
+                std::lock_guard<std::mutex> lck_guard(mut);
+                ++mutex_int;
+            });
+            check("mutex", mutex_int, expected);
+
+            std::atomic<int> atomic_int {0};
+            auto atomic_mops = mops(placement, n, increments, [&] { atomic_int.fetch_add(1, std::memory_order_relaxed); });
+            check("atomic", atomic_int.load(), expected);
+
+            StripedCounter<int> striped_int;
+            auto striped_mops = mops(placement, n, increments, [&] { striped_int.add(1); });
+            check("striped", striped_int.read(), expected);
+
+            std::cout << std::setw(8) << n << std::setw(12) << mutex_mops << std::setw(12) << atomic_mops
+                      << std::setw(12) << striped_mops << std::endl;
+        }
+    }
+    return 0;
+}
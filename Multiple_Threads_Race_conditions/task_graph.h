@@ -0,0 +1,204 @@
+#ifndef MULTIPLE_THREADS_RACE_CONDITIONS_TASK_GRAPH_H
+#define MULTIPLE_THREADS_RACE_CONDITIONS_TASK_GRAPH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "work_stealing.h"
+
+/*
+ * TaskGraph
+ * - main() decides the order of the work by hand
+ *      - Start some threads, join() them all, start the next ones...
+ *      - A thread in the next phase waits for every thread in this phase, not just the ones it needs
+ *
+ * - A task graph declares what each task needs instead
+ *      - emplace(fn) adds a task, and returns its id
+ *      - precede(a, b) says that b must not start until a has finished
+ *      - The tasks and edges must form a DAG (directed acyclic graph)
+ *
+ * - run(pool) runs every task once, on a WorkStealingPool, and returns when they have all finished
+ *      - Each task has an atomic count of the predecessors which have not finished yet
+ *      - A finishing task decrements the count of each of its successors
+ *      - The one which takes a count to zero starts that successor: there is no global lock
+ *      - A task which makes several successors ready spawns all but one, and runs the last itself
+ *
+ * - The graph can be run again and again
+ *      - run() resets the counts, it does not allocate anything for the graph
+ *      - Each node is a PoolTask, so spawning it does not allocate either
+ *      - Only adding tasks or edges changes the graph; not while it is running
+ *
+ * - If a task throws, the tasks which have not started yet are skipped, and run() rethrows
+ *   the first exception once the others have finished
+ * - A cycle would leave its tasks waiting for ever, so run() throws std::logic_error instead
+ *      */
+
+class TaskGraph {
+public:
+    using TaskId = std::size_t;
+
+    TaskGraph() = default;
+
+    TaskGraph(const TaskGraph &source) = delete;
+    TaskGraph &operator=(const TaskGraph &source) = delete;
+
+    TaskId emplace(std::function<void()> fn) {
+        nodes.push_back(std::make_unique<Node>(std::move(fn), nodes.size(), *this));
+        checked = false;
+        return nodes.size() - 1;
+    }
+
+    // "after" waits for "before"
+    void precede(TaskId before, TaskId after) {
+        nodes.at(before)->successors.push_back(nodes.at(after).get());
+        ++nodes[after]->npredecessors;
+        checked = false;
+    }
+
+    std::size_t size() const { return nodes.size(); }
+
+    void run(WorkStealingPool &pool) {
+        if (!checked) {
+            check();
+        }
+        if (nodes.empty()) {
+            return;
+        }
+        for (auto &node : nodes) {
+            node->remaining.store(node->npredecessors, std::memory_order_relaxed);
+        }
+        unfinished.store(nodes.size(), std::memory_order_relaxed);
+        failed.store(false, std::memory_order_relaxed);
+        error = nullptr;
+        finished = false;
+        running_pool = &pool;
+
+        for (auto *source : sources) {
+            pool.spawn(*source);
+        }
+
+        std::unique_lock<std::mutex> uniq_lck(finished_mutex);
+        if (pool.on_worker()) {
+            // Help, rather than blocking a worker which the graph may need
+            while (!finished) {
+                uniq_lck.unlock();
+                if (!pool.run_one()) {
+                    std::this_thread::yield();
+                }
+                uniq_lck.lock();
+            }
+        }
+        else {
+            finished_cv.wait(uniq_lck, [this] { return finished; });
+        }
+        if (error) {
+            std::rethrow_exception(std::exchange(error, nullptr));
+        }
+    }
+
+private:
+    struct Node final : PoolTask {
+        Node(std::function<void()> fn, TaskId id, TaskGraph &graph) : fn(std::move(fn)), id(id), graph(graph) {}
+
+        void run() override { graph.execute(this); }
+
+        std::function<void()> fn;
+        TaskId id;
+        TaskGraph &graph;
+        std::vector<Node *> successors;
+        int npredecessors {0};
+        std::atomic<int> remaining {0};
+    };
+
+    // Find the sources, and make sure that every task can be reached from one (Kahn's algorithm)
+    void check() {
+        sources.clear();
+        std::vector<int> counts;
+        std::vector<Node *> ready;
+        counts.reserve(nodes.size());
+        for (auto &node : nodes) {
+            counts.push_back(node->npredecessors);
+            if (node->npredecessors == 0) {
+                sources.push_back(node.get());
+                ready.push_back(node.get());
+            }
+        }
+        std::size_t visited {0};
+        while (!ready.empty()) {
+            Node *node = ready.back();
+            ready.pop_back();
+            ++visited;
+            for (auto *successor : node->successors) {
+                if (--counts[successor->id] == 0) {
+                    ready.push_back(successor);
+                }
+            }
+        }
+        if (visited != nodes.size()) {
+            throw std::logic_error("TaskGraph has a cycle");
+        }
+        checked = true;
+    }
+
+    // Run a task, then whichever successors it makes ready
+    void execute(Node *node) {
+        while (node) {
+            if (!failed.load(std::memory_order_relaxed)) {
+                try {
+                    node->fn();
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lck_guard(finished_mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    failed.store(true, std::memory_order_relaxed);
+                }
+            }
+
+            Node *next {nullptr};
+            for (auto *successor : node->successors) {
+                if (successor->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (next) {
+                        running_pool->spawn(*next);
+                    }
+                    next = successor;
+                }
+            }
+            task_finished();
+            node = next;
+        }
+    }
+
+    // Notifies with the mutex held: once run() sees "finished" it may return, and the graph may be destroyed
+    void task_finished() {
+        if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lck_guard(finished_mutex);
+            finished = true;
+            finished_cv.notify_all();
+        }
+    }
+
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::vector<Node *> sources;
+    bool checked {false};
+
+    WorkStealingPool *running_pool {nullptr};
+    std::atomic<std::size_t> unfinished {0};
+    std::atomic<bool> failed {false};
+    std::exception_ptr error;
+    std::mutex finished_mutex;
+    std::condition_variable finished_cv;
+    bool finished {false};
+};
+
+#endif //MULTIPLE_THREADS_RACE_CONDITIONS_TASK_GRAPH_H
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "task_graph.h"
+
+/*
+ * TaskGraph benchmark
+ * - Overhead: graphs of empty tasks, run again and again; ns per task
+ *      - wide: one source, "width" tasks which all follow it, one sink
+ *      - deep: a chain of tasks, each waiting for the one before
+ *      - first run (which checks the graph) vs later runs
+ *
+ * - Utilization: "layers" layers of 64 tasks, each spinning for a random 10 to 100 us
+ *      - Each task follows two random tasks of the layer before
+ *      - TaskGraph: a task starts as soon as its two predecessors have finished
+ *      - Phases: each layer is a StealingTaskGroup, waited for before the next starts,
+ *        like the join() chains in main()
+ *      - Critical path: the longest chain of work through the graph, which no number of threads can beat
+ *      - Reports the time, the lower bound max(critical path, total work / threads),
+ *        and how close each one gets to it
+ *
+ * Usage: task_graph_bench [width] [depth] [layers] [threads]
+ *      */
+
+using bench_clock = std::chrono::steady_clock;
+
+void spin_for(std::chrono::nanoseconds duration) {
+    auto until = bench_clock::now() + duration;
+    while (bench_clock::now() < until) {
+    }
+}
+
+template <typename Function>
+double seconds(Function fn) {
+    auto start = bench_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed = bench_clock::now() - start;
+    return elapsed.count();
+}
+
+void overhead(const std::string &name, TaskGraph &graph, WorkStealingPool &pool, int runs) {
+    double first = seconds([&] { graph.run(pool); });
+    double later = seconds([&] {
+        for (int r{0}; r < runs; ++r) {
+            graph.run(pool);
+        }
+    });
+    std::cout << "  " << std::setw(8) << std::left << name << std::right << std::setw(10) << graph.size()
+              << std::setw(12) << first * 1e9 / graph.size()
+              << std::setw(12) << later * 1e9 / (runs * static_cast<double>(graph.size())) << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int depth = argc > 2 ? std::atoi(argv[2]) : 100000;
+    int layers = argc > 3 ? std::atoi(argv[3]) : 50;
+    unsigned nthreads = argc > 4 ? std::atoi(argv[4]) : std::thread::hardware_concurrency();
+
+    WorkStealingPool pool(nthreads);
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << pool.size() << " worker threads" << std::endl;
+
+    std::atomic<long long> ran {0};
+    auto count = [&ran] { ran.fetch_add(1, std::memory_order_relaxed); };
+
+    std::cout << "overhead         tasks   first run  later runs  (ns per task)" << std::endl;
+    TaskGraph wide;
+    auto source = wide.emplace(count);
+    auto sink = wide.emplace(count);
+    for (int i{0}; i < width; ++i) {
+        auto task = wide.emplace(count);
+        wide.precede(source, task);
+        wide.precede(task, sink);
+    }
+    overhead("wide", wide, pool, 10);
+
+    TaskGraph deep;
+    auto previous = deep.emplace(count);
+    for (int i{1}; i < depth; ++i) {
+        auto task = deep.emplace(count);
+        deep.precede(previous, task);
+        previous = task;
+    }
+    overhead("deep", deep, pool, 10);
+
+    long long expected = 11LL * wide.size() + 11LL * deep.size();
+    if (ran.load() != expected) {
+        std::cerr << ran.load() << " tasks ran, not " << expected << std::endl;
+        return 1;
+    }
+
+    // Layered graph with random work and random edges
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> work_us(10, 100);
+    int layer_width = std::max(1, std::min(width, 64));
+    std::uniform_int_distribution<int> pick(0, layer_width - 1);
+    std::vector<std::vector<int>> work(layers, std::vector<int>(layer_width));
+    std::vector<std::vector<std::pair<int, int>>> inputs(layers, std::vector<std::pair<int, int>>(layer_width));
+    std::vector<std::vector<long long>> finish(layers, std::vector<long long>(layer_width));
+    long long total_us {0};
+    long long critical_us {0};
+    for (int l{0}; l < layers; ++l) {
+        for (int i{0}; i < layer_width; ++i) {
+            work[l][i] = work_us(gen);
+            inputs[l][i] = {pick(gen), pick(gen)};
+            long long start = l == 0 ? 0 : std::max(finish[l - 1][inputs[l][i].first], finish[l - 1][inputs[l][i].second]);
+            finish[l][i] = start + work[l][i];
+            total_us += work[l][i];
+            critical_us = std::max(critical_us, finish[l][i]);
+        }
+    }
+
+    TaskGraph layered;
+    std::vector<std::vector<TaskGraph::TaskId>> ids(layers, std::vector<TaskGraph::TaskId>(layer_width));
+    for (int l{0}; l < layers; ++l) {
+        for (int i{0}; i < layer_width; ++i) {
+            ids[l][i] = layered.emplace([us = work[l][i]] { spin_for(std::chrono::microseconds(us)); });
+            if (l > 0) {
+                layered.precede(ids[l - 1][inputs[l][i].first], ids[l][i]);
+                if (inputs[l][i].second != inputs[l][i].first) {
+                    layered.precede(ids[l - 1][inputs[l][i].second], ids[l][i]);
+                }
+            }
+        }
+    }
+    double graph_s = seconds([&] { layered.run(pool); });
+    double phases_s = seconds([&] {
+        for (int l{0}; l < layers; ++l) {
+            StealingTaskGroup group(pool);
+            for (int i{0}; i < layer_width; ++i) {
+                group.run([us = work[l][i]] { spin_for(std::chrono::microseconds(us)); });
+            }
+            group.wait();
+        }
+    });
+
+    double bound_s = std::max(critical_us, total_us / static_cast<long long>(pool.size())) / 1e6;
+    std::cout << "utilization: " << layers << " layers of " << layer_width << " tasks, critical path "
+              << critical_us / 1e3 << " ms, total work " << total_us / 1e3 << " ms" << std::endl;
+    std::cout << "                    ms   bound ms   efficiency %" << std::endl;
+    std::cout << "  TaskGraph " << std::setw(10) << graph_s * 1e3 << std::setw(11) << bound_s * 1e3
+              << std::setw(15) << 100 * bound_s / graph_s << std::endl;
+    std::cout << "  phases    " << std::setw(10) << phases_s * 1e3 << std::setw(11) << bound_s * 1e3
+              << std::setw(15) << 100 * bound_s / phases_s << std::endl;
+    return 0;
+}
@@ -0,0 +1,192 @@
+#ifndef MULTIPLE_THREADS_RACE_CONDITIONS_THREAD_POOL_H
+#define MULTIPLE_THREADS_RACE_CONDITIONS_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+ * ThreadPool
+ * - The demos start a std::thread for every piece of work, then join() it
+ *      - Creating a thread costs tens of microseconds
+ *
+ * - A thread pool starts its worker threads once
+ *      - submit() puts a task on a queue
+ *      - An idle worker takes it off the queue and runs it
+ *      - The workers live until the pool is destroyed
+ *
+ * - run_one() lets any thread run a queued task
+ *      - TaskGroup helps in the same way, with its own tasks only, so a task can submit tasks
+ *        and wait for them without deadlocking the pool
+ *      */
+
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned nthreads = std::thread::hardware_concurrency()) {
+        if (nthreads == 0) {
+            nthreads = 1;
+        }
+        for (unsigned i{0}; i < nthreads; ++i) {
+            workers.emplace_back([this] { run(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool &source) = delete;
+    ThreadPool &operator=(const ThreadPool &source) = delete;
+
+    // Runs every task still on the queue, then stops the workers
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lck_guard(queue_mutex);
+            stopping = true;
+        }
+        queue_cv.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lck_guard(queue_mutex);
+            queue.push_back(std::move(task));
+        }
+        queue_cv.notify_one();
+    }
+
+    // Run one queued task on the calling thread, returns false if the queue was empty
+    bool run_one() {
+        std::unique_lock<std::mutex> uniq_lck(queue_mutex);
+        if (queue.empty()) {
+            return false;
+        }
+        auto task = std::move(queue.front());
+        queue.pop_front();
+        uniq_lck.unlock();
+        task();
+        return true;
+    }
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+private:
+    void run() {
+        while (true) {
+            std::unique_lock<std::mutex> uniq_lck(queue_mutex);
+            queue_cv.wait(uniq_lck, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            auto task = std::move(queue.front());
+            queue.pop_front();
+            uniq_lck.unlock();
+            task();
+        }
+    }
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<std::function<void()>> queue;
+    bool stopping {false};
+    std::vector<std::thread> workers;
+};
+
+// One pool for the whole program, started the first time it is used
+inline ThreadPool &default_pool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+/*
+ * TaskGroup
+ * - run() submits a task to the pool, wait() returns when all of them have finished
+ * - While it waits, the calling thread runs this group's tasks which no worker has started yet
+ *      - Only this group's: a waiter which ran any queued task could start another group's wait
+ *        inside its own, and with many nested groups (parallel_for with grain 1) those waits
+ *        nest until the stack overflows
+ *      - So the waits only nest as deep as the groups themselves do
+ * - If a task throws, wait() rethrows the first exception, after every task has finished
+ *      */
+
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool &pool = default_pool()) : pool(pool), state(std::make_shared<State>()) {}
+
+    TaskGroup(const TaskGroup &source) = delete;
+    TaskGroup &operator=(const TaskGroup &source) = delete;
+
+    ~TaskGroup() {
+        // The tasks usually refer to the caller's local variables, so they must finish first
+        wait_for_tasks();
+    }
+
+    template <typename Function>
+    void run(Function fn) {
+        state->pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lck_guard(state->tasks_mutex);
+            state->tasks.push_back(std::move(fn));
+        }
+        // The worker runs whichever of the group's tasks is next, or nothing if the waiter got to them first.
+        // It holds the state, not the group, which may be gone by then
+        pool.submit([state = state] { state->run_one(); });
+    }
+
+    void wait() {
+        wait_for_tasks();
+        if (state->error) {
+            std::rethrow_exception(std::exchange(state->error, nullptr));
+        }
+    }
+
+private:
+    struct State {
+        std::mutex tasks_mutex;
+        std::deque<std::function<void()>> tasks;
+        std::atomic<int> pending {0};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+
+        bool run_one() {
+            std::unique_lock<std::mutex> uniq_lck(tasks_mutex);
+            if (tasks.empty()) {
+                return false;
+            }
+            try {
+                // Destroyed before pending is decremented, while the waiter is still waiting
+                auto task = std::move(tasks.front());
+                tasks.pop_front();
+                uniq_lck.unlock();
+                task();
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lck_guard(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            pending.fetch_sub(1, std::memory_order_release);
+            return true;
+        }
+    };
+
+    void wait_for_tasks() {
+        while (state->pending.load(std::memory_order_acquire) != 0) {
+            if (!state->run_one()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    ThreadPool &pool;
+    std::shared_ptr<State> state;
+};
+
+#endif //MULTIPLE_THREADS_RACE_CONDITIONS_THREAD_POOL_H
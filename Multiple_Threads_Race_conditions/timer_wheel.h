@@ -0,0 +1,275 @@
+#ifndef MULTIPLE_THREADS_RACE_CONDITIONS_TIMER_WHEEL_H
+#define MULTIPLE_THREADS_RACE_CONDITIONS_TIMER_WHEEL_H
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.h"
+
+/*
+ * TimerWheel
+ * - hello1(num) runs one delayed action by starting a thread which sleeps for num seconds
+ *      - A hundred thousand timeouts would need a hundred thousand sleeping threads
+ *
+ * - A timer service keeps all the timeouts in one data structure
+ *      - One "driver" thread sleeps until the next tick, then fires whatever is due
+ *      - The callbacks are run on a ThreadPool, so a slow callback does not delay the other timers
+ *
+ * - schedule_after(delay, fn) and schedule_at(time, fn) return a TimerId
+ * - cancel(id) stops a timer which has not fired yet
+ *      - Returns false if it has already fired, or was already cancelled
+ *
+ * - Time is measured in ticks (1 ms by default) on std::chrono::steady_clock
+ *      - A timer fires on the first tick at or after its time
+ *      - So it can be up to one tick late, plus however long the driver takes to wake up
+ *      */
+
+/*
+ * Hierarchical timing wheel
+ * - A wheel is an array of 64 slots, each a list of timers; slot = expiry tick % 64
+ *      - Adding a timer: put it on its slot's list - O(1)
+ *      - Cancelling: unlink it from the list - O(1)
+ *      - Each tick: run everything on the current slot's list
+ *
+ * - One wheel of 64 slots only covers 64 ticks, so there are five wheels
+ *      - Wheel 0: one slot per tick, the next 64 ticks
+ *      - Wheel 1: one slot per 64 ticks, the next 64 * 64 ticks
+ *      - ... wheel 4 reaches 2^30 ticks (12 days at 1 ms); later timers are put at the far end
+ *
+ * - Each time wheel 0 goes round, the next slot of wheel 1 is "cascaded"
+ *      - Its timers are now less than 64 ticks away, and are redistributed into wheel 0
+ *      - Each time wheel 1 goes round, the next slot of wheel 2 is cascaded, and so on
+ *      - A timer is moved at most once per wheel
+ *      */
+
+using TimerId = std::uint64_t;
+
+class TimerWheel {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit TimerWheel(ThreadPool &pool = default_pool(),
+                        clock::duration tick = std::chrono::milliseconds(1))
+        : pool(pool), tick(tick), start(clock::now()) {
+        for (auto &wheel : wheels) {
+            wheel.fill(npos);
+        }
+        driver = std::thread([this] { run(); });
+    }
+
+    TimerWheel(const TimerWheel &source) = delete;
+    TimerWheel &operator=(const TimerWheel &source) = delete;
+
+    // Timers which have not fired are dropped
+    ~TimerWheel() {
+        {
+            std::lock_guard<std::mutex> lck_guard(mut);
+            stopping = true;
+        }
+        driver_cv.notify_one();
+        driver.join();
+    }
+
+    TimerId schedule_at(clock::time_point when, std::function<void()> fn) {
+        auto since_start = when - start;
+        auto expires = since_start.count() <= 0 ? 0 : static_cast<std::uint64_t>((since_start + tick - clock::duration(1)) / tick);
+
+        std::lock_guard<std::mutex> lck_guard(mut);
+        if (count == 0) {
+            // The driver does not tick while the wheels are empty, so catch up first
+            current = std::max(current, ticks_since_start());
+        }
+        auto index = allocate_node();
+        auto &node = nodes[index];
+        node.fn = std::move(fn);
+        node.expires = expires;
+        link(index);
+        ++count;
+        if (count == 1) {
+            driver_cv.notify_one();
+        }
+        return (static_cast<TimerId>(node.generation) << 32) | index;
+    }
+
+    template <typename Rep, typename Period>
+    TimerId schedule_after(const std::chrono::duration<Rep, Period> &delay, std::function<void()> fn) {
+        return schedule_at(clock::now() + std::chrono::duration_cast<clock::duration>(delay), std::move(fn));
+    }
+
+    bool cancel(TimerId id) {
+        auto index = static_cast<std::uint32_t>(id);
+        auto generation = static_cast<std::uint32_t>(id >> 32);
+        std::lock_guard<std::mutex> lck_guard(mut);
+        if (index >= nodes.size() || nodes[index].generation != generation || !nodes[index].linked) {
+            return false;
+        }
+        unlink(index);
+        free_node(index);
+        --count;
+        return true;
+    }
+
+    std::size_t pending() const {
+        std::lock_guard<std::mutex> lck_guard(mut);
+        return count;
+    }
+
+private:
+    static constexpr int wheel_bits {6};
+    static constexpr std::uint32_t wheel_size {1u << wheel_bits};
+    static constexpr std::uint32_t wheel_mask {wheel_size - 1};
+    static constexpr int nwheels {5};
+    static constexpr std::uint64_t max_ticks {(1ull << (wheel_bits * nwheels)) - 1};
+    static constexpr std::uint32_t npos {0xffffffff};
+
+    // Timers live in one vector, linked by index, so the vector can grow
+    struct Node {
+        std::function<void()> fn;
+        std::uint64_t expires {0};
+        std::uint32_t prev {npos};
+        std::uint32_t next {npos};
+        std::uint32_t *head {nullptr};  // the slot this node is on
+        std::uint32_t generation {1};   // changes when the node is reused, so old TimerIds are rejected
+        bool linked {false};
+    };
+
+    std::uint64_t ticks_since_start() const {
+        return static_cast<std::uint64_t>((clock::now() - start) / tick);
+    }
+
+    std::uint32_t allocate_node() {
+        if (free_list != npos) {
+            auto index = free_list;
+            free_list = nodes[index].next;
+            return index;
+        }
+        nodes.emplace_back();
+        return static_cast<std::uint32_t>(nodes.size() - 1);
+    }
+
+    void free_node(std::uint32_t index) {
+        auto &node = nodes[index];
+        node.fn = nullptr;
+        ++node.generation;
+        node.next = free_list;
+        free_list = index;
+    }
+
+    // Choose the wheel and slot from how far away the timer is
+    void link(std::uint32_t index) {
+        auto &node = nodes[index];
+        std::uint64_t expires = std::max(node.expires, current);
+        std::uint64_t delta = std::min(expires - current, max_ticks);
+        expires = current + delta;
+        int level {0};
+        while (level < nwheels - 1 && delta >= (1ull << (wheel_bits * (level + 1)))) {
+            ++level;
+        }
+        auto *head = &wheels[level][(expires >> (wheel_bits * level)) & wheel_mask];
+        node.prev = npos;
+        node.next = *head;
+        if (*head != npos) {
+            nodes[*head].prev = index;
+        }
+        *head = index;
+        node.head = head;
+        node.linked = true;
+    }
+
+    void unlink(std::uint32_t index) {
+        auto &node = nodes[index];
+        if (node.prev != npos) {
+            nodes[node.prev].next = node.next;
+        }
+        else {
+            *node.head = node.next;
+        }
+        if (node.next != npos) {
+            nodes[node.next].prev = node.prev;
+        }
+        node.linked = false;
+    }
+
+    // Move every timer on a slot of wheel "level" down to the wheels below
+    void cascade(int level, std::uint32_t slot) {
+        auto index = wheels[level][slot];
+        wheels[level][slot] = npos;
+        while (index != npos) {
+            auto next = nodes[index].next;
+            link(index);
+            index = next;
+        }
+    }
+
+    // Process tick "current", collecting the callbacks which are due
+    void process_tick(std::vector<std::function<void()>> &due) {
+        auto slot = static_cast<std::uint32_t>(current & wheel_mask);
+        for (int level{1}; level < nwheels; ++level) {
+            if ((current & ((1ull << (wheel_bits * level)) - 1)) != 0) {
+                break;
+            }
+            cascade(level, static_cast<std::uint32_t>((current >> (wheel_bits * level)) & wheel_mask));
+        }
+        ++current;
+        auto index = wheels[0][slot];
+        wheels[0][slot] = npos;
+        while (index != npos) {
+            auto next = nodes[index].next;
+            nodes[index].linked = false;
+            due.push_back(std::move(nodes[index].fn));
+            free_node(index);
+            --count;
+            index = next;
+        }
+    }
+
+    void run() {
+        std::vector<std::function<void()>> due;
+        std::unique_lock<std::mutex> uniq_lck(mut);
+        while (!stopping) {
+            if (count == 0) {
+                driver_cv.wait(uniq_lck, [this] { return stopping || count != 0; });
+                continue;
+            }
+            auto due_time = start + tick * static_cast<clock::rep>(current);
+            if (clock::now() < due_time) {
+                driver_cv.wait_until(uniq_lck, due_time);
+                continue;
+            }
+            // Catch up on every tick which is due, then run the callbacks without the lock
+            auto now_ticks = ticks_since_start();
+            while (current <= now_ticks && count != 0) {
+                process_tick(due);
+            }
+            uniq_lck.unlock();
+            for (auto &fn : due) {
+                pool.submit(std::move(fn));
+            }
+            due.clear();
+            uniq_lck.lock();
+        }
+    }
+
+    ThreadPool &pool;
+    const clock::duration tick;
+    const clock::time_point start;
+
+    mutable std::mutex mut;
+    std::condition_variable driver_cv;
+    bool stopping {false};
+    std::uint64_t current {0};  // the next tick to process
+    std::size_t count {0};
+    std::array<std::array<std::uint32_t, wheel_size>, nwheels> wheels;
+    std::vector<Node> nodes;
+    std::uint32_t free_list {npos};
+    std::thread driver;
+};
+
+#endif //MULTIPLE_THREADS_RACE_CONDITIONS_TIMER_WHEEL_H
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "timer_wheel.h"
+
+/*
+ * TimerWheel benchmark
+ * - Schedule: add timers with random delays of 1 to 60 seconds
+ * - Cancel: cancel all of them again, in random order
+ * - Jitter: with the timers pending, fire a batch of short timers (10 to 500 ms)
+ *      - Lateness = time the callback started - time it was scheduled for
+ *      - Reported as median, 99th percentile and maximum
+ * - Thread per timer: the same batch, each a std::thread doing sleep_for() like hello1()
+ *
+ * Usage: timer_wheel_bench [pending timers] [timers fired] [threads for thread per timer]
+ *      */
+
+using bench_clock = TimerWheel::clock;
+
+void print_lateness(const std::string &name, std::vector<double> &late_us) {
+    // Nothing fired, e.g. "timers fired" was 0
+    if (late_us.empty()) {
+        std::cout << "  " << std::setw(18) << std::left << name << std::right
+                  << std::setw(10) << "-" << std::setw(10) << "-" << std::setw(10) << "-" << std::endl;
+        return;
+    }
+    std::sort(late_us.begin(), late_us.end());
+    auto at = [&](double fraction) { return late_us[static_cast<std::size_t>(fraction * (late_us.size() - 1))]; };
+    std::cout << "  " << std::setw(18) << std::left << name << std::right
+              << std::setw(10) << at(0.5) << std::setw(10) << at(0.99) << std::setw(10) << late_us.back() << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int npending = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int nfired = argc > 2 ? std::atoi(argv[2]) : 10000;
+    int nthreads = argc > 3 ? std::atoi(argv[3]) : 1000;
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> long_ms(1000, 60000);
+    std::uniform_int_distribution<int> short_ms(10, 500);
+
+    ThreadPool pool;
+    TimerWheel wheel(pool);
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << pool.size() << " pool threads" << std::endl;
+
+    std::vector<TimerId> ids(npending);
+    auto start = bench_clock::now();
+    for (auto &id : ids) {
+        id = wheel.schedule_after(std::chrono::milliseconds(long_ms(gen)), [] {});
+    }
+    std::chrono::duration<double, std::nano> scheduling = bench_clock::now() - start;
+    std::cout << "schedule (ns)    " << scheduling.count() / npending << "   " << wheel.pending() << " pending" << std::endl;
+
+    // Fire a batch while the long timers are still pending
+    std::vector<double> late_us(nfired);
+    std::atomic<int> fired {0};
+    for (int i{0}; i < nfired; ++i) {
+        auto when = bench_clock::now() + std::chrono::milliseconds(short_ms(gen));
+        wheel.schedule_at(when, [&, i, when] {
+            late_us[i] = std::chrono::duration<double, std::micro>(bench_clock::now() - when).count();
+            fired.fetch_add(1);
+        });
+    }
+    while (fired.load() < nfired) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::shuffle(ids.begin(), ids.end(), gen);
+    start = bench_clock::now();
+    int cancelled {0};
+    for (auto id : ids) {
+        cancelled += wheel.cancel(id);
+    }
+    std::chrono::duration<double, std::nano> cancelling = bench_clock::now() - start;
+    std::cout << "cancel (ns)      " << cancelling.count() / npending << "   " << cancelled << " cancelled" << std::endl;
+
+    std::vector<double> thread_late_us(nthreads);
+    std::vector<std::thread> threads;
+    for (int i{0}; i < nthreads; ++i) {
+        auto when = bench_clock::now() + std::chrono::milliseconds(short_ms(gen));
+        threads.push_back(std::thread([&, i, when] {
+            std::this_thread::sleep_until(when);
+            thread_late_us[i] = std::chrono::duration<double, std::micro>(bench_clock::now() - when).count();
+        }));
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    std::cout << "lateness (us)             median       p99       max" << std::endl;
+    print_lateness("timer wheel", late_us);
+    print_lateness("thread per timer", thread_late_us);
+    return 0;
+}
@@ -0,0 +1,447 @@
+#ifndef MULTIPLE_THREADS_RACE_CONDITIONS_WORK_STEALING_H
+#define MULTIPLE_THREADS_RACE_CONDITIONS_WORK_STEALING_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+ * Work-stealing deque (Chase and Lev, "Dynamic Circular Work-Stealing Deque", 2005)
+ * - Owned by one thread, which push()es and pop()s tasks at the bottom
+ *      - Last in, first out: the task it pushed most recently is still in its cache
+ *      - Neither needs an atomic read-modify-write, only when taking the last task
+ * - Any other thread may steal() from the top
+ *      - First in, first out: the oldest task, which is usually the biggest piece of work
+ *      - A thief claims a task with compare_exchange on "top"
+ *
+ * - The tasks are kept in a circular array, which push() doubles when it is full
+ *      - A thief may still be reading the old array, so old arrays are kept until the deque is destroyed
+ * - The memory orders follow Le, Pop, Cohen and Zappa Nardelli,
+ *   "Correct and Efficient Work-Stealing for Weak Memory Models", 2013
+ *      */
+
+template <typename T>
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(std::int64_t capacity = 256) {
+        arrays.push_back(std::make_unique<Array>(capacity));
+        array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque &source) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &source) = delete;
+
+    // Owner only
+    void push(T item) {
+        std::int64_t b = bottom.load(std::memory_order_relaxed);
+        std::int64_t t = top.load(std::memory_order_acquire);
+        Array *a = array.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1) {
+            a = grow(a, t, b);
+        }
+        a->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only; false if the deque was empty
+    bool pop(T &item) {
+        std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array *a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        item = a->get(b);
+        if (t == b) {
+            // The last task: race the thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread; false if the deque was empty, or another thread took the task first
+    bool steal(T &item) {
+        std::int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+        Array *a = array.load(std::memory_order_acquire);
+        item = a->get(t);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // Only an estimate while other threads are using the deque
+    bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Array {
+        explicit Array(std::int64_t capacity) : capacity(capacity), mask(capacity - 1), items(capacity) {}
+
+        T get(std::int64_t i) const { return items[i & mask].load(std::memory_order_relaxed); }
+        void put(std::int64_t i, T item) { items[i & mask].store(item, std::memory_order_relaxed); }
+
+        const std::int64_t capacity;  // a power of two
+        const std::int64_t mask;
+        std::vector<std::atomic<T>> items;
+    };
+
+    Array *grow(Array *old, std::int64_t t, std::int64_t b) {
+        arrays.push_back(std::make_unique<Array>(old->capacity * 2));
+        Array *bigger = arrays.back().get();
+        for (std::int64_t i{t}; i < b; ++i) {
+            bigger->put(i, old->get(i));
+        }
+        array.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    alignas(64) std::atomic<std::int64_t> top {0};
+    alignas(64) std::atomic<std::int64_t> bottom {0};
+    std::atomic<Array *> array;
+    std::vector<std::unique_ptr<Array>> arrays;  // only the owner touches this
+};
+
+/*
+ * WorkStealingPool
+ * - ThreadPool has one queue, which every worker takes its tasks from
+ *      - Every submit() and every task taken locks the same mutex
+ *
+ * - WorkStealingPool gives each worker its own WorkStealingDeque
+ *      - A task spawned on a worker goes on that worker's deque, and that worker normally runs it
+ *      - A worker whose deque is empty picks other workers at random, and steals from them
+ *      - Tasks spawned by other threads go on a shared queue, which idle workers check
+ *      - A worker which finds nothing to do sleeps until a task is spawned
+ *
+ * - Divide and conquer fits this well
+ *      - A task splits its work in two, spawns one half, and works on the other
+ *      - Thieves take the oldest, biggest halves, so steals are rare
+ *
+ * - spawned() counts the tasks, steals() the ones which a worker took from another worker's deque
+ *      */
+
+/*
+ * PoolTask
+ * - spawn(fn) allocates a std::function, and its captures too if they are bigger than a couple of pointers
+ * - A PoolTask lives somewhere else, e.g. inside a TaskGraph node, and is reused
+ *      - spawn(task) puts a pointer to it on a deque, and a worker calls task.run(): nothing is allocated
+ *      - It must stay alive until run() has been called, and not be spawned again before that
+ *      */
+
+class PoolTask {
+public:
+    virtual ~PoolTask() = default;
+    virtual void run() = 0;
+};
+
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned nthreads = std::thread::hardware_concurrency()) {
+        if (nthreads == 0) {
+            nthreads = 1;
+        }
+        for (unsigned i{0}; i < nthreads; ++i) {
+            workers.push_back(std::make_unique<Worker>(i + 1));
+        }
+        for (unsigned i{0}; i < nthreads; ++i) {
+            workers[i]->thread = std::thread([this, i] { run(i); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool &source) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &source) = delete;
+
+    // Runs every task which has been spawned, then stops the workers
+    ~WorkStealingPool() {
+        while (run_one()) {
+        }
+        {
+            std::lock_guard<std::mutex> lck_guard(sleep_mutex);
+            stopping = true;
+        }
+        sleep_cv.notify_all();
+        for (auto &worker : workers) {
+            worker->thread.join();
+        }
+    }
+
+    void spawn(std::function<void()> fn) {
+        push(new FunctionTask(std::move(fn)));
+    }
+
+    void spawn(PoolTask &task) {
+        push(&task);
+    }
+
+    // Run one task on the calling thread: its own, a stolen one, or one from the shared queue
+    // Returns false if none was found
+    bool run_one() {
+        Task task {nullptr};
+        if (!find_task(task)) {
+            return false;
+        }
+        execute(task);
+        return true;
+    }
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    // true on this pool's worker threads
+    bool on_worker() const { return this_worker_pool == this; }
+
+    long long steals() const {
+        long long total {0};
+        for (auto &worker : workers) {
+            total += worker->steals.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    long long spawned() {
+        std::lock_guard<std::mutex> lck_guard(injection_mutex);
+        long long total {injected};
+        for (auto &worker : workers) {
+            total += worker->spawned.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    // Only while no tasks are running
+    void reset_stats() {
+        std::lock_guard<std::mutex> lck_guard(injection_mutex);
+        injected = 0;
+        for (auto &worker : workers) {
+            worker->steals.store(0, std::memory_order_relaxed);
+            worker->spawned.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    using Task = PoolTask *;
+
+    // A spawn(fn) task, which deletes itself once it has run
+    struct FunctionTask final : PoolTask {
+        explicit FunctionTask(std::function<void()> fn) : fn(std::move(fn)) {}
+
+        void run() override {
+            std::unique_ptr<FunctionTask> owned(this);
+            fn();
+        }
+
+        std::function<void()> fn;
+    };
+
+    struct alignas(64) Worker {
+        explicit Worker(std::uint32_t seed) : random(seed * 2654435761u) {}
+
+        // xorshift, to pick a victim
+        std::uint32_t next_random() {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            return random;
+        }
+
+        WorkStealingDeque<Task> deque;
+        // Written only by the owner; atomic so that the totals can be read at any time
+        std::atomic<long long> steals {0};
+        std::atomic<long long> spawned {0};
+        std::uint32_t random;
+        std::thread thread;
+    };
+
+    void push(Task task) {
+        if (this_worker_pool == this) {
+            auto &worker = *workers[this_worker_index];
+            worker.deque.push(task);
+            worker.spawned.store(worker.spawned.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        else {
+            std::lock_guard<std::mutex> lck_guard(injection_mutex);
+            injection.push_back(task);
+            ++injected;
+        }
+        wake_one();
+    }
+
+    void execute(Task task) {
+        task->run();
+    }
+
+    bool find_task(Task &task) {
+        Worker *self = this_worker_pool == this ? workers[this_worker_index].get() : nullptr;
+        if (self && self->deque.pop(task)) {
+            return true;
+        }
+        // Try each other worker once, starting at a random one
+        unsigned n = size();
+        unsigned first = self ? self->next_random() % n : 0;
+        for (unsigned i{0}; i < n; ++i) {
+            Worker *victim = workers[(first + i) % n].get();
+            if (victim != self && victim->deque.steal(task)) {
+                if (self) {
+                    self->steals.store(self->steals.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                }
+                return true;
+            }
+        }
+        std::lock_guard<std::mutex> lck_guard(injection_mutex);
+        if (injection.empty()) {
+            return false;
+        }
+        task = injection.front();
+        injection.pop_front();
+        return true;
+    }
+
+    bool any_work() {
+        for (auto &worker : workers) {
+            if (!worker->deque.empty()) {
+                return true;
+            }
+        }
+        std::lock_guard<std::mutex> lck_guard(injection_mutex);
+        return !injection.empty();
+    }
+
+    // A spawner publishes its task, then checks for sleepers
+    // A sleeper registers itself, then checks for tasks; one of them sees the other
+    void wake_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) != 0) {
+            { std::lock_guard<std::mutex> lck_guard(sleep_mutex); }
+            sleep_cv.notify_one();
+        }
+    }
+
+    void run(unsigned index) {
+        this_worker_pool = this;
+        this_worker_index = index;
+        while (true) {
+            // A few rounds of looking before sleeping, as spawned tasks tend to come in bursts
+            bool found {false};
+            for (int round{0}; round < 64 && !found; ++round) {
+                if (run_one()) {
+                    found = true;
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+            if (found) {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> uniq_lck(sleep_mutex);
+            if (stopping) {
+                return;
+            }
+            sleepers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!any_work()) {
+                sleep_cv.wait(uniq_lck);
+            }
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::mutex injection_mutex;
+    std::deque<Task> injection;
+    long long injected {0};
+
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+    std::atomic<int> sleepers {0};
+    bool stopping {false};
+
+    static inline thread_local WorkStealingPool *this_worker_pool {nullptr};
+    static inline thread_local unsigned this_worker_index {0};
+};
+
+/*
+ * StealingTaskGroup
+ * - Like TaskGroup, for a WorkStealingPool
+ * - run() spawns a task; on a worker it goes on that worker's own deque
+ * - wait() on a worker runs tasks (its own first, then stolen ones) until every task in the group has finished
+ *      - So tasks can create groups and wait for them, to any depth
+ *      - Each task run while waiting is nested on the waiter's stack; popping its own deque first
+ *        keeps that to the depth of the task tree, plus a frame for each steal
+ * - wait() on any other thread only yields
+ *      - Helping would let it run the oldest tasks, each of which waits and runs more, with no limit on the nesting
+ *      - So start a large tree of tasks with a single run(), and let the workers divide it
+ * - If a task throws, wait() rethrows the first exception, after every task has finished
+ *      */
+
+class StealingTaskGroup {
+public:
+    explicit StealingTaskGroup(WorkStealingPool &pool) : pool(pool) {}
+
+    StealingTaskGroup(const StealingTaskGroup &source) = delete;
+    StealingTaskGroup &operator=(const StealingTaskGroup &source) = delete;
+
+    ~StealingTaskGroup() {
+        // The tasks refer to this object, so it must not go away before they finish
+        wait_for_tasks();
+    }
+
+    template <typename Function>
+    void run(Function fn) {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        pool.spawn([this, fn = std::move(fn)]() mutable {
+            try {
+                auto task = std::move(fn);
+                task();
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lck_guard(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            pending.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    void wait() {
+        wait_for_tasks();
+        if (error) {
+            std::rethrow_exception(std::exchange(error, nullptr));
+        }
+    }
+
+private:
+    void wait_for_tasks() {
+        bool help = pool.on_worker();
+        while (pending.load(std::memory_order_acquire) != 0) {
+            if (!help || !pool.run_one()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    WorkStealingPool &pool;
+    std::atomic<int> pending {0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+};
+
+#endif //MULTIPLE_THREADS_RACE_CONDITIONS_WORK_STEALING_H
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.h"
+#include "work_stealing.h"
+
+/*
+ * Work-stealing benchmark: two recursive task trees
+ * - fib(n): each call spawns fib(n - 1) as a task and computes fib(n - 2) itself
+ *      - Below the cutoff it recurses without tasks
+ *      - Millions of tiny tasks: mostly measures the cost of spawning and finding a task
+ * - quicksort: partition, spawn one half, sort the other
+ *      - Below the cutoff it calls std::sort
+ *      - Uneven halves: the load has to be balanced as it goes
+ *
+ * - Each is run on one thread, and on WorkStealingPool with StealingTaskGroup
+ *      - The whole tree is started with one run(), see StealingTaskGroup
+ *      - Reports the time, the speedup over one thread, tasks spawned and tasks stolen
+ * - Both are also run on ThreadPool (one shared queue) with TaskGroup
+ *
+ * Usage: work_stealing_bench [fib n] [fib cutoff] [number of ints to sort] [threads]
+ *      */
+
+using bench_clock = std::chrono::steady_clock;
+
+long long fib_serial(int n) {
+    return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+template <typename Pool, typename Group>
+long long fib_tasks(Pool &pool, int n, int cutoff) {
+    if (n < cutoff) {
+        return fib_serial(n);
+    }
+    long long x {0};
+    Group group(pool);
+    group.run([&] { x = fib_tasks<Pool, Group>(pool, n - 1, cutoff); });
+    long long y = fib_tasks<Pool, Group>(pool, n - 2, cutoff);
+    group.wait();
+    return x + y;
+}
+
+template <typename Pool, typename Group>
+void quicksort_tasks(Pool &pool, std::vector<int>::iterator first, std::vector<int>::iterator last, long cutoff) {
+    if (last - first < cutoff) {
+        std::sort(first, last);
+        return;
+    }
+    int pivot = *(first + (last - first) / 2);
+    auto middle = std::partition(first, last, [pivot](int value) { return value < pivot; });
+    // Then the elements equal to the pivot, which are already in place, so both halves shrink
+    auto upper = std::partition(middle, last, [pivot](int value) { return !(pivot < value); });
+    Group group(pool);
+    group.run([&] { quicksort_tasks<Pool, Group>(pool, first, middle, cutoff); });
+    quicksort_tasks<Pool, Group>(pool, upper, last, cutoff);
+    group.wait();
+}
+
+struct Row {
+    std::string name;
+    double seconds;
+    long long tasks;
+    long long steals;
+};
+
+void print_rows(const std::string &title, const std::vector<Row> &rows) {
+    std::cout << title << std::endl;
+    std::cout << "                        seconds   speedup      tasks     steals" << std::endl;
+    for (auto &row : rows) {
+        std::cout << "  " << std::setw(20) << std::left << row.name << std::right << std::setw(9) << row.seconds
+                  << std::setw(10) << rows[0].seconds / row.seconds << std::setw(11) << row.tasks
+                  << std::setw(11) << row.steals << std::endl;
+    }
+}
+
+// Start a task tree from outside the pool
+template <typename Function>
+void run_in(WorkStealingPool &pool, Function fn) {
+    StealingTaskGroup group(pool);
+    group.run(fn);
+    group.wait();
+}
+
+template <typename Function>
+double seconds(Function fn) {
+    auto start = bench_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed = bench_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 36;
+    int cutoff = argc > 2 ? std::atoi(argv[2]) : 12;
+    long count = argc > 3 ? std::atol(argv[3]) : 10000000L;
+    unsigned nthreads = argc > 4 ? std::atoi(argv[4]) : std::thread::hardware_concurrency();
+
+    ThreadPool shared(nthreads);
+    WorkStealingPool stealing(nthreads);
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << stealing.size() << " worker threads" << std::endl;
+
+    long long expected {0}, result {0};
+    std::vector<Row> fib_rows;
+    fib_rows.push_back({"one thread", seconds([&] { expected = fib_serial(n); }), 0, 0});
+    fib_rows.push_back({"ThreadPool", seconds([&] {
+        result = fib_tasks<ThreadPool, TaskGroup>(shared, n, cutoff);
+    }), 0, 0});
+    if (result != expected) {
+        std::cerr << "ThreadPool fib is " << result << ", not " << expected << std::endl;
+        return 1;
+    }
+    stealing.reset_stats();
+    fib_rows.push_back({"WorkStealingPool", seconds([&] {
+        run_in(stealing, [&] { result = fib_tasks<WorkStealingPool, StealingTaskGroup>(stealing, n, cutoff); });
+    }), stealing.spawned(), stealing.steals()});
+    if (result != expected) {
+        std::cerr << "WorkStealingPool fib is " << result << ", not " << expected << std::endl;
+        return 1;
+    }
+    // The same tree of tasks, on the other pool
+    fib_rows[1].tasks = fib_rows[2].tasks;
+    print_rows("fib(" + std::to_string(n) + "), cutoff " + std::to_string(cutoff), fib_rows);
+
+    std::vector<int> original(count);
+    std::mt19937 gen(42);
+    for (auto &value : original) {
+        value = static_cast<int>(gen());
+    }
+    auto sorted = original;
+    std::vector<Row> sort_rows;
+    sort_rows.push_back({"one thread", seconds([&] { std::sort(sorted.begin(), sorted.end()); }), 0, 0});
+
+    auto data = original;
+    sort_rows.push_back({"ThreadPool", seconds([&] {
+        quicksort_tasks<ThreadPool, TaskGroup>(shared, data.begin(), data.end(), 10000);
+    }), 0, 0});
+    if (data != sorted) {
+        std::cerr << "ThreadPool quicksort did not sort" << std::endl;
+        return 1;
+    }
+    data = original;
+    stealing.reset_stats();
+    sort_rows.push_back({"WorkStealingPool", seconds([&] {
+        run_in(stealing, [&] {
+            quicksort_tasks<WorkStealingPool, StealingTaskGroup>(stealing, data.begin(), data.end(), 10000);
+        });
+    }), stealing.spawned(), stealing.steals()});
+    if (data != sorted) {
+        std::cerr << "WorkStealingPool quicksort did not sort" << std::endl;
+        return 1;
+    }
+    // The same tree of tasks, on the other pool
+    sort_rows[1].tasks = sort_rows[2].tasks;
+    print_rows("quicksort of " + std::to_string(count) + " ints", sort_rows);
+    return 0;
+}
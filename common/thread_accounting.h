@@ -0,0 +1,214 @@
+#ifndef COMMON_THREAD_ACCOUNTING_H
+#define COMMON_THREAD_ACCOUNTING_H
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+
+/*
+ * Per-thread accounting
+ * - A slow run of dine() could be spent computing, sleeping, or waiting for a fork
+ *      - Wall time alone does not say which
+ *
+ * - ThreadAccount account("philosopher A"); at the top of a thread function
+ *      - Its constructor samples, its destructor samples again and records the difference
+ *      - Wall time: std::chrono::steady_clock
+ *      - CPU time: clock_gettime(CLOCK_THREAD_CPUTIME_ID), this thread only
+ *      - Context switches, from getrusage(RUSAGE_THREAD):
+ *          - voluntary: the thread blocked - sleep_for(), a mutex, I/O
+ *          - involuntary: the kernel took the CPU away, e.g. more runnable threads than CPUs
+ *      - now() gives the usage so far, without recording it
+ *
+ * - ThreadAccounting::global().report(std::cout) prints one line per thread name
+ *      - The threads recorded under one name are added up, and counted
+ *      - So the records take memory per name, not per thread: a program which keeps starting
+ *        threads under a few names does not grow
+ *      - Off CPU = wall - CPU: sleeping, waiting for a lock, or runnable but not running
+ *
+ * - Cheap enough to leave on: one sample is about a microsecond (a clock read, a CPU clock read
+ *   and getrusage), taken at each end of a thread, plus a mutex when it records
+ * - See thread_accounting_bench.cpp in deadlock
+ *
+ * - RUSAGE_THREAD is Linux only; elsewhere (macOS) the context switch columns show "-"
+ *
+ * - In common/, for more than one project: a target which uses it adds ../common to its include directories
+ *      */
+
+struct ThreadUsage {
+    std::string name;
+    std::chrono::nanoseconds wall {0};
+    std::chrono::nanoseconds cpu {0};
+    long voluntary_switches {0};
+    long involuntary_switches {0};
+};
+
+namespace accounting_detail {
+    struct Sample {
+        std::chrono::steady_clock::time_point wall;
+        std::chrono::nanoseconds cpu;
+        long voluntary_switches;
+        long involuntary_switches;
+    };
+
+    inline Sample sample() {
+        Sample s {std::chrono::steady_clock::now(), std::chrono::nanoseconds(0), -1, -1};
+        timespec ts {};
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+            s.cpu = std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+        }
+#if defined(RUSAGE_THREAD)
+        rusage usage {};
+        if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+            s.voluntary_switches = usage.ru_nvcsw;
+            s.involuntary_switches = usage.ru_nivcsw;
+        }
+#endif
+        return s;
+    }
+
+    inline long switches(long start, long end) {
+        return start < 0 || end < 0 ? -1 : end - start;
+    }
+}
+
+class ThreadAccounting {
+public:
+    ThreadAccounting() = default;
+    ThreadAccounting(const ThreadAccounting &source) = delete;
+    ThreadAccounting &operator=(const ThreadAccounting &source) = delete;
+
+    static ThreadAccounting &global() {
+        static ThreadAccounting accounting;
+        return accounting;
+    }
+
+    // Adds the usage to the total for its name
+    void record(const ThreadUsage &usage) {
+        std::lock_guard<std::mutex> lck_guard(records_mutex);
+        auto &record = records[usage.name];
+        record.usage.name = usage.name;
+        add(record.usage, usage);
+        ++record.threads;
+    }
+
+    // One total per name, by name
+    std::vector<ThreadUsage> usages() const {
+        std::vector<ThreadUsage> totals;
+        std::lock_guard<std::mutex> lck_guard(records_mutex);
+        for (const auto &record : records) {
+            totals.push_back(record.second.usage);
+        }
+        return totals;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lck_guard(records_mutex);
+        records.clear();
+    }
+
+    // One line per name, then the totals
+    void report(std::ostream &out) const {
+        std::map<std::string, Record> copy;
+        {
+            std::lock_guard<std::mutex> lck_guard(records_mutex);
+            copy = records;
+        }
+        Record total;
+        total.usage.name = "total";
+        for (const auto &record : copy) {
+            add(total.usage, record.second.usage);
+            total.threads += record.second.threads;
+        }
+
+        auto flags = out.flags();
+        auto precision = out.precision();
+        out << std::fixed << std::setprecision(1);
+        out << std::setw(20) << std::left << "thread" << std::right << std::setw(9) << "threads" << std::setw(12)
+            << "wall ms" << std::setw(12) << "CPU ms" << std::setw(8) << "CPU %" << std::setw(12) << "off CPU ms"
+            << std::setw(12) << "voluntary" << std::setw(14) << "involuntary" << std::endl;
+        for (const auto &record : copy) {
+            line(out, record.second);
+        }
+        if (copy.size() > 1) {
+            line(out, total);
+        }
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+private:
+    struct Record {
+        ThreadUsage usage;
+        long threads {0};
+    };
+
+    static void add(ThreadUsage &total, const ThreadUsage &usage) {
+        total.wall += usage.wall;
+        total.cpu += usage.cpu;
+        total.voluntary_switches = add_switches(total.voluntary_switches, usage.voluntary_switches);
+        total.involuntary_switches = add_switches(total.involuntary_switches, usage.involuntary_switches);
+    }
+
+    static long add_switches(long total, long n) {
+        return total < 0 || n < 0 ? -1 : total + n;
+    }
+
+    static std::string switches(long n) {
+        return n < 0 ? "-" : std::to_string(n);
+    }
+
+    static void line(std::ostream &out, const Record &record) {
+        using ms = std::chrono::duration<double, std::milli>;
+        const ThreadUsage &usage = record.usage;
+        double wall = ms(usage.wall).count();
+        double cpu = ms(usage.cpu).count();
+        out << std::setw(20) << std::left << usage.name << std::right << std::setw(9) << record.threads
+            << std::setw(12) << wall << std::setw(12) << cpu
+            << std::setw(8) << (wall > 0 ? 100 * cpu / wall : 0.0) << std::setw(12) << std::max(0.0, wall - cpu);
+        out << std::setw(12) << switches(usage.voluntary_switches) << std::setw(14)
+            << switches(usage.involuntary_switches) << std::endl;
+    }
+
+    mutable std::mutex records_mutex;
+    std::map<std::string, Record> records;
+};
+
+// Must be created and destroyed on the thread it measures
+class ThreadAccount {
+public:
+    explicit ThreadAccount(std::string name, ThreadAccounting &accounting = ThreadAccounting::global())
+        : name(std::move(name)), accounting(accounting), start(accounting_detail::sample()) {}
+
+    ThreadAccount(const ThreadAccount &source) = delete;
+    ThreadAccount &operator=(const ThreadAccount &source) = delete;
+
+    ~ThreadAccount() {
+        accounting.record(now());
+    }
+
+    // Usage since construction
+    ThreadUsage now() const {
+        auto end = accounting_detail::sample();
+        return {name,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end.wall - start.wall),
+                end.cpu - start.cpu,
+                accounting_detail::switches(start.voluntary_switches, end.voluntary_switches),
+                accounting_detail::switches(start.involuntary_switches, end.involuntary_switches)};
+    }
+
+private:
+    std::string name;
+    ThreadAccounting &accounting;
+    accounting_detail::Sample start;
+};
+
+#endif //COMMON_THREAD_ACCOUNTING_H
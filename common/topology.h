@@ -0,0 +1,345 @@
+#ifndef COMMON_TOPOLOGY_H
+#define COMMON_TOPOLOGY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*
+ * CPU topology and thread pinning
+ * - The threads in main() run wherever the kernel puts them, and it may move them
+ *      - So the same benchmark can give different results from run to run
+ *      - Two threads on SMT siblings share a core; two threads on different packages
+ *        (sockets) send every shared cache line across the interconnect
+ *
+ * - CpuTopology::system() reads the layout once, from /sys/devices/system
+ *      - For each CPU the kernel lets us use: its core, package, NUMA node and SMT sibling index
+ *      - The caches, and which CPUs share each one
+ *      - Without /sys (e.g. macOS) every CPU is its own core, on one package and one node
+ *
+ * - ThreadPlacement(policy) picks the CPU for the 1st, 2nd... thread
+ *      - PinPolicy::none: no pinning
+ *      - compact: fill a core's SMT siblings, then the next core, then the next package
+ *      - scatter: one thread per package in turn, then per core, and SMT siblings last
+ *      - one_per_core: the first SMT sibling of each core only; more threads than cores share them
+ *      - avoid_smt: one per core first, then the other siblings once every core has a thread
+ *      - launch(index, fn) starts a std::thread which pins itself, then runs fn
+ *
+ * - Pinning uses pthread_setaffinity_np, so it only works on Linux
+ *      - macOS only has affinity hints; there launch() starts an ordinary thread
+ *
+ * - In common/, for more than one project: a target which uses it adds ../common to its include directories
+ *      */
+
+enum class PinPolicy { none, compact, scatter, one_per_core, avoid_smt };
+
+inline const char *pin_policy_name(PinPolicy policy) {
+    switch (policy) {
+        case PinPolicy::none: return "none";
+        case PinPolicy::compact: return "compact";
+        case PinPolicy::scatter: return "scatter";
+        case PinPolicy::one_per_core: return "one_per_core";
+        case PinPolicy::avoid_smt: return "avoid_smt";
+    }
+    return "?";
+}
+
+// false if the name is not a policy
+inline bool pin_policy_from_name(const std::string &name, PinPolicy &policy) {
+    for (auto p : {PinPolicy::none, PinPolicy::compact, PinPolicy::scatter, PinPolicy::one_per_core,
+                   PinPolicy::avoid_smt}) {
+        if (name == pin_policy_name(p)) {
+            policy = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct CpuInfo {
+    int cpu;
+    int core;       // Unique over the machine, not the kernel's per-package core_id
+    int package;
+    int node;
+    int smt_index;  // 0 for the first sibling on its core
+};
+
+struct CacheInfo {
+    int level;
+    std::string type;           // "Data", "Instruction" or "Unified"
+    std::size_t size;           // Bytes
+    std::vector<int> cpus;      // The CPUs which share it
+};
+
+namespace topology_detail {
+    inline std::string read_line(const std::string &path) {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line);
+        return line;
+    }
+
+    inline int read_int(const std::string &path, int fallback) {
+        std::string line = read_line(path);
+        return line.empty() ? fallback : std::stoi(line);
+    }
+
+    // "0-3,8,10-11"
+    inline std::vector<int> parse_cpu_list(const std::string &list) {
+        std::vector<int> cpus;
+        std::stringstream stream(list);
+        std::string range;
+        while (std::getline(stream, range, ',')) {
+            if (range.empty()) {
+                continue;
+            }
+            auto dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+    // "48K", "2048K", "32M"
+    inline std::size_t parse_size(const std::string &text) {
+        if (text.empty()) {
+            return 0;
+        }
+        std::size_t size = std::stoul(text);
+        switch (text.back()) {
+            case 'K': return size << 10;
+            case 'M': return size << 20;
+            case 'G': return size << 30;
+            default: return size;
+        }
+    }
+
+    inline std::string format_size(std::size_t size) {
+        if (size >= (std::size_t{1} << 20) && size % (std::size_t{1} << 20) == 0) {
+            return std::to_string(size >> 20) + "M";
+        }
+        return std::to_string(size >> 10) + "K";
+    }
+
+    // The CPUs this process may run on
+    inline std::vector<int> allowed_cpus() {
+        std::vector<int> cpus;
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu{0}; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+#endif
+        if (cpus.empty()) {
+            unsigned n = std::max(1u, std::thread::hardware_concurrency());
+            for (unsigned cpu{0}; cpu < n; ++cpu) {
+                cpus.push_back(static_cast<int>(cpu));
+            }
+        }
+        return cpus;
+    }
+}
+
+class CpuTopology {
+public:
+    // Read once, on first use
+    static const CpuTopology &system() {
+        static const CpuTopology topology;
+        return topology;
+    }
+
+    const std::vector<CpuInfo> &cpus() const { return cpu_list; }
+    const std::vector<CacheInfo> &caches() const { return cache_list; }
+    int cores() const { return ncores; }
+    int packages() const { return npackages; }
+    int nodes() const { return nnodes; }
+
+    // The CPUs in the order "policy" hands them out; empty for PinPolicy::none
+    std::vector<int> order(PinPolicy policy) const {
+        std::vector<CpuInfo> sorted = cpu_list;
+        auto by = [&sorted](auto key) {
+            std::stable_sort(sorted.begin(), sorted.end(),
+                             [&key](const CpuInfo &a, const CpuInfo &b) { return key(a) < key(b); });
+        };
+        switch (policy) {
+            case PinPolicy::none:
+                return {};
+            case PinPolicy::compact:
+                by([](const CpuInfo &c) { return std::make_tuple(c.node, c.package, c.core, c.smt_index); });
+                break;
+            case PinPolicy::scatter: {
+                // Rank each core within its package, then deal them out one package at a time
+                std::map<int, std::vector<int>> cores_of_package;
+                for (const auto &c : cpu_list) {
+                    auto &cores = cores_of_package[c.package];
+                    if (std::find(cores.begin(), cores.end(), c.core) == cores.end()) {
+                        cores.push_back(c.core);
+                    }
+                }
+                auto rank = [&cores_of_package](const CpuInfo &c) {
+                    const auto &cores = cores_of_package.at(c.package);
+                    return static_cast<int>(std::find(cores.begin(), cores.end(), c.core) - cores.begin());
+                };
+                by([&rank](const CpuInfo &c) { return std::make_tuple(c.smt_index, rank(c), c.package); });
+                break;
+            }
+            case PinPolicy::one_per_core:
+                sorted.erase(std::remove_if(sorted.begin(), sorted.end(),
+                                            [](const CpuInfo &c) { return c.smt_index != 0; }),
+                             sorted.end());
+                by([](const CpuInfo &c) { return std::make_tuple(c.node, c.package, c.core); });
+                break;
+            case PinPolicy::avoid_smt:
+                by([](const CpuInfo &c) { return std::make_tuple(c.smt_index, c.node, c.package, c.core); });
+                break;
+        }
+        std::vector<int> result;
+        for (const auto &c : sorted) {
+            result.push_back(c.cpu);
+        }
+        return result;
+    }
+
+    // e.g. "8 CPUs, 4 cores, 1 package, 1 NUMA node; L1d 48K x4, L2 1280K x4, L3 12M x1"
+    void describe(std::ostream &out) const {
+        out << cpu_list.size() << " CPUs, " << ncores << " cores, " << npackages
+            << (npackages == 1 ? " package, " : " packages, ") << nnodes << (nnodes == 1 ? " NUMA node" : " NUMA nodes");
+        // cache_list is sorted by level and type, so each kind is one run
+        const char *separator = "; ";
+        for (std::size_t i{0}; i < cache_list.size();) {
+            std::size_t j = i;
+            while (j < cache_list.size() && cache_list[j].level == cache_list[i].level &&
+                   cache_list[j].type == cache_list[i].type) {
+                ++j;
+            }
+            if (cache_list[i].type != "Instruction") {
+                out << separator << "L" << cache_list[i].level << (cache_list[i].type == "Data" ? "d " : " ")
+                    << topology_detail::format_size(cache_list[i].size) << " x" << j - i;
+                separator = ", ";
+            }
+            i = j;
+        }
+    }
+
+private:
+    CpuTopology() {
+        using namespace topology_detail;
+        const std::string root = "/sys/devices/system/";
+
+        std::map<int, int> node_of_cpu;
+        for (int node : parse_cpu_list(read_line(root + "node/online"))) {
+            for (int cpu : parse_cpu_list(read_line(root + "node/node" + std::to_string(node) + "/cpulist"))) {
+                node_of_cpu[cpu] = node;
+            }
+        }
+
+        std::map<std::pair<int, int>, int> core_numbers;  // (package, core_id) -> core
+        std::map<int, int> siblings_seen;                 // core -> SMT threads seen so far
+        std::set<std::tuple<int, std::string, std::vector<int>>> seen_caches;
+        for (int cpu : allowed_cpus()) {
+            std::string dir = root + "cpu/cpu" + std::to_string(cpu) + "/";
+            int package = read_int(dir + "topology/physical_package_id", 0);
+            int core_id = read_int(dir + "topology/core_id", cpu);
+            auto inserted = core_numbers.emplace(std::make_pair(package, core_id), static_cast<int>(core_numbers.size()));
+            int core = inserted.first->second;
+            auto node = node_of_cpu.find(cpu);
+            cpu_list.push_back({cpu, core, package, node == node_of_cpu.end() ? 0 : node->second, siblings_seen[core]++});
+
+            for (int index{0};; ++index) {
+                std::string cache_dir = dir + "cache/index" + std::to_string(index) + "/";
+                std::string level = read_line(cache_dir + "level");
+                if (level.empty()) {
+                    break;
+                }
+                std::string type = read_line(cache_dir + "type");
+                auto sharing = parse_cpu_list(read_line(cache_dir + "shared_cpu_list"));
+                if (seen_caches.emplace(std::stoi(level), type, sharing).second) {
+                    cache_list.push_back({std::stoi(level), type, parse_size(read_line(cache_dir + "size")), sharing});
+                }
+            }
+        }
+        std::stable_sort(cache_list.begin(), cache_list.end(), [](const CacheInfo &a, const CacheInfo &b) {
+            return std::tie(a.level, a.type) < std::tie(b.level, b.type);
+        });
+
+        std::set<int> package_set, node_set;
+        for (const auto &c : cpu_list) {
+            package_set.insert(c.package);
+            node_set.insert(c.node);
+        }
+        ncores = static_cast<int>(core_numbers.size());
+        npackages = static_cast<int>(package_set.size());
+        nnodes = static_cast<int>(node_set.size());
+    }
+
+    std::vector<CpuInfo> cpu_list;
+    std::vector<CacheInfo> cache_list;
+    int ncores {0};
+    int npackages {0};
+    int nnodes {0};
+};
+
+// Pins the calling thread; false if that is not possible here
+inline bool pin_this_thread(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+class ThreadPlacement {
+public:
+    explicit ThreadPlacement(PinPolicy policy = PinPolicy::none, const CpuTopology &topology = CpuTopology::system())
+        : policy(policy), cpu_order(topology.order(policy)) {}
+
+    PinPolicy pin_policy() const { return policy; }
+
+    // The CPU for thread number "index", wrapping around when there are more threads than CPUs; -1 for none
+    int cpu_for(unsigned index) const {
+        return cpu_order.empty() ? -1 : cpu_order[index % cpu_order.size()];
+    }
+
+    template <typename Function>
+    std::thread launch(unsigned index, Function fn) const {
+        int cpu = cpu_for(index);
+        return std::thread([cpu, fn = std::move(fn)]() mutable {
+            if (cpu >= 0) {
+                pin_this_thread(cpu);
+            }
+            fn();
+        });
+    }
+
+private:
+    PinPolicy policy;
+    std::vector<int> cpu_order;
+};
+
+#endif //COMMON_TOPOLOGY_H
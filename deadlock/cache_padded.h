@@ -0,0 +1,104 @@
+#ifndef DEADLOCK_CACHE_PADDED_H
+#define DEADLOCK_CACHE_PADDED_H
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/*
+ * False sharing
+ * - std::vector<int> mouthfuls(nphilosophers, 0)
+ *      - Each philosopher only updates its own element
+ *      - But the elements are next to each other in memory, on the same cache line
+ *
+ * - The CPU cache works with whole lines (64 bytes), not single ints
+ *      - When one core writes its element, the line is taken away from every other core
+ *      - The next core to write its element has to fetch the line back
+ *      - The threads share no data, but they fight over the line as if they did
+ *
+ * - The cure is to put each thread's data on its own cache line
+ *      */
+
+constexpr std::size_t cache_line_size {64};
+
+/*
+ * CachePadded<T>
+ * - A T, aligned to the start of a cache line, and padded to a whole number of lines
+ * - Two CachePadded objects never share a line
+ *      - In an array, or a std::vector, each element is on its own line
+ *      */
+
+template <typename T>
+struct alignas(cache_line_size) CachePadded {
+    CachePadded() : value() {}
+    explicit CachePadded(const T &initial) : value(initial) {}
+    explicit CachePadded(T &&initial) : value(std::move(initial)) {}
+
+    T &get() { return value; }
+    const T &get() const { return value; }
+    T &operator*() { return value; }
+    const T &operator*() const { return value; }
+    T *operator->() { return &value; }
+    const T *operator->() const { return &value; }
+
+    T value;
+};
+
+/*
+ * PerThread<T>
+ * - A fixed number of slots, each one a CachePadded<T>
+ *
+ * - A thread gets a slot in one of two ways
+ *      - By index, when the program already numbers its threads: slots[nphilo]
+ *      - With claim(), which hands out the next free slot, once per thread
+ *        Keep the reference it returns, claim() is not meant to be called on every access
+ *
+ * - for_each(fn) visits every slot, combine(init, op) folds them into one value
+ *      - For T which is written while this runs, use std::atomic<...> or another thread-safe T
+ *      */
+
+template <typename T>
+class PerThread {
+public:
+    explicit PerThread(std::size_t nslots) : slots(nslots) {}
+
+    PerThread(const PerThread &source) = delete;
+    PerThread &operator=(const PerThread &source) = delete;
+
+    std::size_t size() const { return slots.size(); }
+
+    T &operator[](std::size_t index) { return slots[index].value; }
+    const T &operator[](std::size_t index) const { return slots[index].value; }
+
+    // Hands out each slot once; throws if they have all been claimed
+    T &claim() {
+        auto index = next_unclaimed.fetch_add(1, std::memory_order_relaxed);
+        if (index >= slots.size()) {
+            throw std::out_of_range("PerThread: no free slot");
+        }
+        return slots[index].value;
+    }
+
+    template <typename Function>
+    void for_each(Function fn) {
+        for (auto &slot : slots) {
+            fn(slot.value);
+        }
+    }
+
+    template <typename Result, typename Combine>
+    Result combine(Result init, Combine op) const {
+        for (auto &slot : slots) {
+            init = op(init, slot.value);
+        }
+        return init;
+    }
+
+private:
+    std::vector<CachePadded<T>> slots;
+    std::atomic<std::size_t> next_unclaimed {0};
+};
+
+#endif //DEADLOCK_CACHE_PADDED_H
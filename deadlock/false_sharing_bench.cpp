@@ -0,0 +1,123 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cache_padded.h"
+
+/*
+ * False sharing benchmark
+ * - Each thread increments its own counter, like increment_value(nphilo) on mouthfuls[nphilo]
+ * - From 1 thread up to 64
+ *
+ * - one mutex: every counter behind increment_mut, as in the demo
+ * - packed: std::vector<std::atomic<int>>, neighbouring counters share a cache line
+ * - padded: PerThread<std::atomic<int>>, each counter on its own line
+ *
+ * - Each layout is run with two increments
+ *      - fetch_add: an atomic read-modify-write
+ *      - load+store: what a thread which owns its counter really needs
+ *
+ * - The total is checked with PerThread::combine() and by summing the vector
+ *
+ * Usage: false_sharing_bench [max threads] [increments per thread]
+ *      */
+
+template <typename Increment>
+double mops(unsigned nthreads, int increments, Increment increment) {
+    std::atomic<bool> start {false};
+    std::vector<std::thread> threads;
+    for (unsigned t{0}; t < nthreads; ++t) {
+        threads.push_back(std::thread([&, t] {
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (int i{0}; i < increments; ++i) {
+                increment(t);
+            }
+        }));
+    }
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return static_cast<double>(nthreads) * increments / elapsed.count() / 1e6;
+}
+
+void check(const std::string &name, long long total, long long expected) {
+    if (total != expected) {
+        std::cerr << name << ": total " << total << ", expected " << expected << std::endl;
+    }
+}
+
+long long sum(const std::vector<std::atomic<int>> &counters) {
+    long long total {0};
+    for (auto &counter : counters) {
+        total += counter.load();
+    }
+    return total;
+}
+
+long long sum(const PerThread<std::atomic<int>> &counters) {
+    return counters.combine(0LL, [](long long total, const std::atomic<int> &counter) { return total + counter.load(); });
+}
+
+int main(int argc, char *argv[]) {
+    unsigned max_threads = argc > 1 ? std::atoi(argv[1]) : 64;
+    int increments = argc > 2 ? std::atoi(argv[2]) : 2000000;
+
+    std::cout << "millions of increments per second, " << increments << " per thread" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "one mutex"
+              << std::setw(16) << "packed RMW" << std::setw(16) << "padded RMW"
+              << std::setw(16) << "packed ld+st" << std::setw(16) << "padded ld+st" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (unsigned n{1}; n <= max_threads; n *= 2) {
+        long long expected = static_cast<long long>(n) * increments;
+
+        std::mutex increment_mut;
+        std::vector<int> mouthfuls(n, 0);
+        auto mutex_mops = mops(n, increments, [&](unsigned t) {
+            std::lock_guard<std::mutex> increment_lock(increment_mut);
+            mouthfuls[t]++;
+        });
+        long long mutex_total {0};
+        for (auto count : mouthfuls) {
+            mutex_total += count;
+        }
+        check("one mutex", mutex_total, expected);
+
+        std::vector<std::atomic<int>> packed(n);
+        auto packed_rmw = mops(n, increments, [&](unsigned t) { packed[t].fetch_add(1, std::memory_order_relaxed); });
+        check("packed RMW", sum(packed), expected);
+
+        PerThread<std::atomic<int>> padded(n);
+        auto padded_rmw = mops(n, increments, [&](unsigned t) { padded[t].fetch_add(1, std::memory_order_relaxed); });
+        check("padded RMW", sum(padded), expected);
+
+        std::vector<std::atomic<int>> packed_owned(n);
+        auto packed_ls = mops(n, increments, [&](unsigned t) {
+            auto &counter = packed_owned[t];
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        });
+        check("packed ld+st", sum(packed_owned), expected);
+
+        PerThread<std::atomic<int>> padded_owned(n);
+        auto padded_ls = mops(n, increments, [&](unsigned t) {
+            auto &counter = padded_owned[t];
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        });
+        check("padded ld+st", sum(padded_owned), expected);
+
+        std::cout << std::setw(8) << n << std::setw(12) << mutex_mops << std::setw(16) << packed_rmw
+                  << std::setw(16) << padded_rmw << std::setw(16) << packed_ls << std::setw(16) << padded_ls << std::endl;
+    }
+    return 0;
+}
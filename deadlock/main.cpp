@@ -4,6 +4,9 @@
 #include <string>
 #include <chrono>
 #include <thread>
+
+#include "thread_accounting.h"
+
 using namespace std::literals;
 
 
@@ -562,6 +565,14 @@ std::vector<std::string> names {"A", "B", "C", "D", "E"};
 // Keep track of how many times a philosopher is able to eat
 std::vector<int> mouthfuls(nphilosophers,0);
 
+/*
+ * The elements of mouthfuls are next to each other, on one cache line
+ * - Fine while increment_mut serializes the philosophers
+ * - Without the mutex (each philosopher updating its own element), the line moves between cores on every update
+ * - PerThread<std::atomic<int>> mouthfuls(nphilosophers) puts each element on its own line (cache_padded.h)
+ * - See false_sharing_bench.cpp
+ *      */
+
 // A philosopher who has not picked up both forks is thinking
 constexpr auto think_time = 2s;
 
@@ -588,6 +599,9 @@ void print(int n, const std::string &str) {
     std::lock_guard<std::mutex> print_lock(print_mutex);
     std::cout << "Philosopher " << names[n] << str << std::endl;
 }
+// One lock per increment; for counters bumped on a hot path, a DeferredCounter
+// (Multiple_Threads_Race_conditions/deferred_counter.h) adds into a thread_local total instead
+// and flushes it now and then - see deferred_counter_bench.cpp
 std::mutex increment_mut;
 void increment_value(int phil) {
     std::lock_guard<std::mutex> increment_lock(increment_mut);
@@ -609,6 +623,10 @@ void dine(int nphilo) {
     int lfork = nphilo;
     int rfork = (nphilo+1) % nforks;
 
+    // Records wall time, CPU time and context switches when dine() returns
+    // The philosophers spend almost all of it off the CPU: thinking, eating, or waiting for a fork
+    ThreadAccount account("philosopher " + names[nphilo]);
+
     print(nphilo, "\'s forks are ", lfork, rfork);
     print(nphilo, " is thinking....");
     std::this_thread::sleep_for(think_time);
@@ -650,6 +668,9 @@ int main() {
 //        std::cout << "Philosopher " << names[i];
 //        std::cout << " had " << mouthfuls[i] << " mouthfuls" << std::endl;
 //    }
+//
+//    // Where did each philosopher's time go?
+//    ThreadAccounting::global().report(std::cout);
 
     std::thread thrZ (funcZ);
     std::this_thread::sleep_for(10ms);
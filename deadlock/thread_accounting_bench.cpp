@@ -0,0 +1,111 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "thread_accounting.h"
+
+using namespace std::literals;
+
+/*
+ * Thread accounting benchmark
+ * - Overhead: the cost of one sample (what ThreadAccount does at each end of a thread)
+ *      - steady_clock::now(), clock_gettime(CLOCK_THREAD_CPUTIME_ID) and getrusage(RUSAGE_THREAD)
+ *        on their own, then a whole ThreadAccount::now()
+ *
+ * - Report: three kinds of thread, which all take about the same wall time
+ *      - compute: spins on the CPU
+ *      - sleep: sleep_for(), like think_time and eat_time in dine()
+ *      - lock wait: waits for a mutex which a compute thread holds, like a philosopher waiting for a fork
+ *      - The table tells them apart by CPU % and voluntary context switches
+ *      - Two compute and two sleep threads, each pair under one name: their usages are added up
+ *
+ * Usage: thread_accounting_bench [samples] [milliseconds per thread]
+ *      */
+
+using bench_clock = std::chrono::steady_clock;
+
+template <typename Function>
+double ns_per_call(int iterations, Function fn) {
+    auto start = bench_clock::now();
+    for (int i{0}; i < iterations; ++i) {
+        fn();
+    }
+    std::chrono::duration<double, std::nano> elapsed = bench_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+// Busy for "duration" of wall time
+long spin_for(std::chrono::milliseconds duration) {
+    long n {0};
+    auto end = bench_clock::now() + duration;
+    while (bench_clock::now() < end) {
+        ++n;
+    }
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    int samples = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    auto run_time = std::chrono::milliseconds(argc > 2 ? std::atoi(argv[2]) : 200);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "ns per call" << std::endl;
+    std::cout << "  steady_clock::now()           " << ns_per_call(samples, [] { bench_clock::now(); }) << std::endl;
+    std::cout << "  CLOCK_THREAD_CPUTIME_ID       " << ns_per_call(samples, [] {
+        timespec ts {};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    }) << std::endl;
+#if defined(RUSAGE_THREAD)
+    std::cout << "  getrusage(RUSAGE_THREAD)      " << ns_per_call(samples, [] {
+        rusage usage {};
+        getrusage(RUSAGE_THREAD, &usage);
+    }) << std::endl;
+#endif
+    {
+        ThreadAccounting scratch;
+        ThreadAccount account("overhead", scratch);
+        std::cout << "  ThreadAccount::now()          " << ns_per_call(samples, [&account] { account.now(); })
+                  << std::endl;
+    }
+
+    std::cout << std::endl << "threads of " << run_time.count() << " ms each" << std::endl;
+    std::mutex fork;
+    std::atomic<bool> fork_taken {false};
+    std::vector<std::thread> threads;
+    for (int i{0}; i < 2; ++i) {
+        threads.push_back(std::thread([run_time] {
+            ThreadAccount account("compute");
+            spin_for(run_time);
+        }));
+        threads.push_back(std::thread([run_time] {
+            ThreadAccount account("sleep");
+            for (auto slept = 0ms; slept < run_time; slept += 10ms) {
+                std::this_thread::sleep_for(10ms);
+            }
+        }));
+    }
+    threads.push_back(std::thread([&] {
+        ThreadAccount account("compute holding");
+        std::lock_guard<std::mutex> lck_guard(fork);
+        fork_taken = true;
+        spin_for(run_time);
+    }));
+    while (!fork_taken) {
+        std::this_thread::yield();
+    }
+    threads.push_back(std::thread([&] {
+        ThreadAccount account("lock wait");
+        std::lock_guard<std::mutex> lck_guard(fork);
+    }));
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    ThreadAccounting::global().report(std::cout);
+    return 0;
+}
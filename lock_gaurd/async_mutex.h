@@ -0,0 +1,195 @@
+#ifndef LOCK_GAURD_ASYNC_MUTEX_H
+#define LOCK_GAURD_ASYNC_MUTEX_H
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+#include "executor.h"
+
+/*
+ * AsyncMutex
+ * - A mutex for coroutines (C++20)
+ *      - co_await mut.lock() suspends the coroutine, not the thread
+ *      - The thread is free to run other coroutines while this one waits
+ *      - A blocked std::mutex waiter costs a whole thread and its stack
+ *      - A suspended coroutine costs only its frame
+ *
+ * - co_await mut.lock() returns an AsyncLockGuard
+ *      - Same idea as std::unique_lock
+ *      - The destructor unlocks the mutex
+ *      - unlock() releases it early
+ *
+ * - Ownership is handed off directly
+ *      - unlock() gives the mutex to the oldest waiter (FIFO)
+ *      - The waiter is resumed on the executor, if there is one
+ *      - Otherwise it is resumed inline by the unlocking thread
+ *      */
+
+/*
+ * Implementation
+ * - All the state is in a single atomic word
+ *      - not_locked
+ *      - locked_no_waiters
+ *      - Otherwise, a pointer to the most recent waiter
+ *
+ * - Waiters push themselves onto a lock-free stack (LIFO)
+ *      - The awaiter object lives in the suspended coroutine frame
+ *      - No memory is allocated to wait
+ *
+ * - The lock holder takes the whole stack in one exchange()
+ *      - It reverses it into a FIFO list that only the holder touches
+ *      */
+
+class AsyncMutex;
+
+class AsyncLockGuard {
+public:
+    AsyncLockGuard(AsyncMutex &mut, std::adopt_lock_t) noexcept : mut(&mut) {}
+
+    AsyncLockGuard(const AsyncLockGuard &source) = delete;
+    AsyncLockGuard &operator=(const AsyncLockGuard &source) = delete;
+
+    AsyncLockGuard(AsyncLockGuard &&source) noexcept : mut(std::exchange(source.mut, nullptr)) {}
+    AsyncLockGuard &operator=(AsyncLockGuard &&source) noexcept {
+        if (this != &source) {
+            unlock();
+            mut = std::exchange(source.mut, nullptr);
+        }
+        return *this;
+    }
+
+    ~AsyncLockGuard() { unlock(); }
+
+    bool owns_lock() const noexcept { return mut != nullptr; }
+
+    inline void unlock() noexcept;
+
+private:
+    AsyncMutex *mut;
+};
+
+class AsyncMutex {
+public:
+    class LockAwaiter;
+
+    explicit AsyncMutex(Executor *executor = nullptr) noexcept : executor(executor) {}
+
+    AsyncMutex(const AsyncMutex &source) = delete;
+    AsyncMutex &operator=(const AsyncMutex &source) = delete;
+
+    ~AsyncMutex() = default;
+
+    bool try_lock() noexcept {
+        auto old = not_locked;
+        return state.compare_exchange_strong(old, locked_no_waiters,
+                                             std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    // auto guard = co_await mut.lock();
+    inline LockAwaiter lock() noexcept;
+
+    inline void unlock() noexcept;
+
+private:
+    static constexpr std::uintptr_t not_locked {1};
+    static constexpr std::uintptr_t locked_no_waiters {0};
+
+    static inline LockAwaiter *take_stack(std::uintptr_t top) noexcept;
+
+    void resume(std::coroutine_handle<> handle) {
+        if (executor != nullptr) {
+            executor->post(handle);
+        }
+        else {
+            handle.resume();
+        }
+    }
+
+    std::atomic<std::uintptr_t> state {not_locked};
+    // FIFO list of waiters, only accessed by the thread which holds the lock
+    LockAwaiter *waiters {nullptr};
+    Executor *executor;
+};
+
+class AsyncMutex::LockAwaiter {
+public:
+    explicit LockAwaiter(AsyncMutex &mut) noexcept : mut(mut) {}
+
+    bool await_ready() noexcept { return mut.try_lock(); }
+
+    bool await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle = awaiting;
+        auto old = mut.state.load(std::memory_order_acquire);
+        while (true) {
+            if (old == not_locked) {
+                // Unlocked since await_ready() - take it and carry on without suspending
+                if (mut.state.compare_exchange_weak(old, locked_no_waiters,
+                                                    std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return false;
+                }
+            }
+            else {
+                next = reinterpret_cast<LockAwaiter *>(old);
+                if (mut.state.compare_exchange_weak(old, reinterpret_cast<std::uintptr_t>(this),
+                                                    std::memory_order_release, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    AsyncLockGuard await_resume() noexcept { return AsyncLockGuard(mut, std::adopt_lock); }
+
+private:
+    friend class AsyncMutex;
+
+    AsyncMutex &mut;
+    LockAwaiter *next {nullptr};
+    std::coroutine_handle<> handle;
+};
+
+AsyncMutex::LockAwaiter AsyncMutex::lock() noexcept {
+    return LockAwaiter(*this);
+}
+
+AsyncMutex::LockAwaiter *AsyncMutex::take_stack(std::uintptr_t top) noexcept {
+    // locked_no_waiters is 0, so the bottom of the stack has a null next
+    auto *awaiter = reinterpret_cast<LockAwaiter *>(top);
+    LockAwaiter *head {nullptr};
+    while (awaiter != nullptr) {
+        auto *tmp = awaiter->next;
+        awaiter->next = head;
+        head = awaiter;
+        awaiter = tmp;
+    }
+    return head;
+}
+
+void AsyncMutex::unlock() noexcept {
+    LockAwaiter *head = waiters;
+    if (head == nullptr) {
+        // Nobody queued up on the holder's list: release, unless a waiter arrived meanwhile
+        auto old = locked_no_waiters;
+        if (state.compare_exchange_strong(old, not_locked,
+                                          std::memory_order_release, std::memory_order_relaxed)) {
+            return;
+        }
+        // Take the whole stack of new waiters, and reverse it so the oldest is first
+        old = state.exchange(locked_no_waiters, std::memory_order_acquire);
+        head = take_stack(old);
+    }
+    waiters = head->next;
+    // The mutex stays locked - ownership passes straight to the waiter
+    resume(head->handle);
+}
+
+void AsyncLockGuard::unlock() noexcept {
+    if (mut != nullptr) {
+        std::exchange(mut, nullptr)->unlock();
+    }
+}
+
+#endif //LOCK_GAURD_ASYNC_MUTEX_H
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <latch>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async_mutex.h"
+#include "async_semaphore.h"
+
+using namespace std::literals;
+
+/*
+ * AsyncMutex demo
+ * - The main thread locks the mutex, like task1() holding the_mutex
+ * - 100,000 coroutines then try to lock it
+ *      - They all suspend, but no thread is blocked
+ *      - Only a handful of executor threads exist
+ * - The main thread unlocks, and the mutex is handed from waiter to waiter
+ *
+ * - Measured:
+ *      - Memory per suspended waiter (coroutine frame and process RSS)
+ *      - Handoff latency: from unlock() to the next owner running
+ *      - The same memory figures for blocked std::thread waiters
+ *
+ * - AsyncSemaphore bounds how many coroutines are "in flight" at once
+ *
+ * Usage: async_mutex_bench [waiters] [executor threads] [std::thread waiters]
+ *      */
+
+using bench_clock = std::chrono::steady_clock;
+
+// Fire-and-forget coroutine, its frame is freed when it finishes
+struct DetachedTask {
+    struct promise_type {
+        static inline std::atomic<std::size_t> frame_bytes {0};
+
+        static void *operator new(std::size_t size) {
+            frame_bytes.fetch_add(size, std::memory_order_relaxed);
+            return ::operator new(size);
+        }
+        static void operator delete(void *ptr) { ::operator delete(ptr); }
+
+        DetachedTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// Read a "VmRSS:" style line from /proc/self/status, in kB
+long proc_status_kb(const std::string &field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size(), field) == 0) {
+            return std::stol(line.substr(field.size()));
+        }
+    }
+    return 0;
+}
+
+// Shared data, only accessed by the coroutine which owns the mutex
+struct Shared {
+    bench_clock::time_point released_at;
+    long long counter {0};
+    std::vector<long long> handoff_ns;
+};
+
+DetachedTask waiter(AsyncMutex &mut, Shared &shared, std::latch &done) {
+    auto guard = co_await mut.lock();
+    // start of critical section
+    auto now = bench_clock::now();
+    shared.handoff_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(now - shared.released_at).count());
+    ++shared.counter;
+    shared.released_at = bench_clock::now();
+    // end of critical section
+    guard.unlock();
+    done.count_down();
+}
+
+void coroutine_waiters(int nwaiters, unsigned nthreads) {
+    Shared shared;
+    shared.handoff_ns.reserve(nwaiters);
+    std::latch done(nwaiters);
+    ThreadPoolExecutor executor(nthreads);
+    AsyncMutex mut(&executor);
+
+    // Hold the mutex while the waiters arrive
+    mut.try_lock();
+
+    long rss_before = proc_status_kb("VmRSS:");
+    for (int i{0}; i < nwaiters; ++i) {
+        waiter(mut, shared, done);
+    }
+    long rss_after = proc_status_kb("VmRSS:");
+    auto frame_bytes = DetachedTask::promise_type::frame_bytes.load();
+
+    std::cout << "coroutine waiters:     " << nwaiters << " on " << nthreads << " executor threads" << std::endl;
+    std::cout << "  frame size:          " << frame_bytes / nwaiters << " bytes per waiter" << std::endl;
+    std::cout << "  RSS growth:          " << (rss_after - rss_before) * 1024.0 / nwaiters << " bytes per waiter" << std::endl;
+
+    auto start = bench_clock::now();
+    shared.released_at = start;
+    mut.unlock();
+    done.wait();
+    auto elapsed = bench_clock::now() - start;
+
+    auto &lat = shared.handoff_ns;
+    std::sort(lat.begin(), lat.end());
+    auto percentile = [&lat](double p) { return lat[static_cast<std::size_t>(p * (lat.size() - 1))]; };
+    std::cout << "  handoffs:            " << shared.counter << " in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms" << std::endl;
+    std::cout << "  handoff latency ns:  p50 " << percentile(0.5) << ", p99 " << percentile(0.99)
+              << ", p99.9 " << percentile(0.999) << ", max " << lat.back() << std::endl;
+}
+
+void thread_waiters(int nwaiters) {
+    std::mutex mut;
+    std::vector<std::thread> threads;
+    std::atomic<int> arrived {0};
+
+    std::unique_lock<std::mutex> uniq_lck(mut);
+    long rss_before = proc_status_kb("VmRSS:");
+    long vm_before = proc_status_kb("VmSize:");
+    for (int i{0}; i < nwaiters; ++i) {
+        threads.push_back(std::thread([&mut, &arrived] {
+            arrived.fetch_add(1);
+            std::lock_guard<std::mutex> lck_guard(mut);
+        }));
+    }
+    while (arrived.load() < nwaiters) {
+        std::this_thread::sleep_for(1ms);
+    }
+    long rss_after = proc_status_kb("VmRSS:");
+    long vm_after = proc_status_kb("VmSize:");
+    uniq_lck.unlock();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    std::cout << "std::thread waiters:   " << nwaiters << std::endl;
+    std::cout << "  RSS growth:          " << (rss_after - rss_before) * 1024.0 / nwaiters << " bytes per waiter" << std::endl;
+    std::cout << "  address space:       " << (vm_after - vm_before) * 1024.0 / nwaiters << " bytes per waiter" << std::endl;
+}
+
+// Suspend, and continue on one of the executor's threads - stands in for asynchronous I/O
+struct Reschedule {
+    Executor &executor;
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> handle) { executor.post(handle); }
+    void await_resume() {}
+};
+
+DetachedTask bounded_job(AsyncSemaphore &sem, Executor &executor, std::atomic<int> &in_flight,
+                         std::atomic<int> &max_in_flight, std::latch &done) {
+    co_await sem.acquire();
+    int now = in_flight.fetch_add(1) + 1;
+    int seen = max_in_flight.load();
+    while (now > seen && !max_in_flight.compare_exchange_weak(seen, now)) {
+    }
+    co_await Reschedule{executor};
+    in_flight.fetch_sub(1);
+    sem.release();
+    done.count_down();
+}
+
+void semaphore_jobs(int njobs, unsigned nthreads, std::uint32_t permits) {
+    std::atomic<int> in_flight {0};
+    std::atomic<int> max_in_flight {0};
+    std::latch done(njobs);
+    ThreadPoolExecutor executor(nthreads);
+    AsyncSemaphore sem(permits, &executor);
+
+    auto start = bench_clock::now();
+    for (int i{0}; i < njobs; ++i) {
+        bounded_job(sem, executor, in_flight, max_in_flight, done);
+    }
+    done.wait();
+    auto elapsed = bench_clock::now() - start;
+
+    std::cout << "AsyncSemaphore:        " << njobs << " jobs, " << permits << " permits" << std::endl;
+    std::cout << "  most jobs in flight: " << max_in_flight.load() << std::endl;
+    std::cout << "  time:                "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int nwaiters = argc > 1 ? std::atoi(argv[1]) : 100000;
+    unsigned nthreads = argc > 2 ? std::atoi(argv[2]) : 4;
+    int nthread_waiters = argc > 3 ? std::atoi(argv[3]) : 256;
+
+    coroutine_waiters(nwaiters, nthreads);
+    thread_waiters(nthread_waiters);
+    semaphore_jobs(nwaiters, nthreads, 8);
+    return 0;
+}
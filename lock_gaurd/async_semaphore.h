@@ -0,0 +1,115 @@
+#ifndef LOCK_GAURD_ASYNC_SEMAPHORE_H
+#define LOCK_GAURD_ASYNC_SEMAPHORE_H
+
+#include <coroutine>
+#include <cstdint>
+#include <mutex>
+
+#include "executor.h"
+
+/*
+ * AsyncSemaphore
+ * - The coroutine version of CountingSemaphore (semaphore.h), C++20
+ *      - co_await sem.acquire() suspends the coroutine until a permit is free
+ *      - release() hands the permit straight to the oldest waiter
+ *      - The waiter is resumed on the executor, or inline if there is none
+ *
+ * - Waiters are kept in a FIFO list of awaiters
+ *      - Each awaiter lives in its suspended coroutine frame
+ *      - The list and the count are protected by a std::mutex
+ *      - The mutex is only held for a few instructions, never while waiting
+ *      */
+
+class AsyncSemaphore {
+public:
+    class AcquireAwaiter;
+
+    explicit AsyncSemaphore(std::uint32_t initial, Executor *executor = nullptr)
+        : count(initial), executor(executor) {}
+
+    AsyncSemaphore(const AsyncSemaphore &source) = delete;
+    AsyncSemaphore &operator=(const AsyncSemaphore &source) = delete;
+
+    bool try_acquire() {
+        std::lock_guard<std::mutex> lck_guard(mut);
+        if (count == 0) {
+            return false;
+        }
+        --count;
+        return true;
+    }
+
+    // co_await sem.acquire();
+    inline AcquireAwaiter acquire();
+
+    inline void release();
+
+private:
+    std::mutex mut;
+    std::uint32_t count;
+    AcquireAwaiter *head {nullptr};
+    AcquireAwaiter *tail {nullptr};
+    Executor *executor;
+};
+
+class AsyncSemaphore::AcquireAwaiter {
+public:
+    explicit AcquireAwaiter(AsyncSemaphore &sem) : sem(sem) {}
+
+    bool await_ready() { return sem.try_acquire(); }
+
+    bool await_suspend(std::coroutine_handle<> awaiting) {
+        std::lock_guard<std::mutex> lck_guard(sem.mut);
+        // A permit may have been released since await_ready()
+        if (sem.count != 0) {
+            --sem.count;
+            return false;
+        }
+        handle = awaiting;
+        if (sem.tail != nullptr) {
+            sem.tail->next = this;
+        }
+        else {
+            sem.head = this;
+        }
+        sem.tail = this;
+        return true;
+    }
+
+    void await_resume() {}
+
+private:
+    friend class AsyncSemaphore;
+
+    AsyncSemaphore &sem;
+    AcquireAwaiter *next {nullptr};
+    std::coroutine_handle<> handle;
+};
+
+AsyncSemaphore::AcquireAwaiter AsyncSemaphore::acquire() {
+    return AcquireAwaiter(*this);
+}
+
+void AsyncSemaphore::release() {
+    std::unique_lock<std::mutex> uniq_lck(mut);
+    AcquireAwaiter *waiter = head;
+    if (waiter == nullptr) {
+        ++count;
+        return;
+    }
+    head = waiter->next;
+    if (head == nullptr) {
+        tail = nullptr;
+    }
+    uniq_lck.unlock();
+
+    // The permit goes straight to the waiter, count is unchanged
+    if (executor != nullptr) {
+        executor->post(waiter->handle);
+    }
+    else {
+        waiter->handle.resume();
+    }
+}
+
+#endif //LOCK_GAURD_ASYNC_SEMAPHORE_H
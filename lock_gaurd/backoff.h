@@ -0,0 +1,143 @@
+#ifndef LOCK_GAURD_BACKOFF_H
+#define LOCK_GAURD_BACKOFF_H
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+
+/*
+ * Acquiring a lock with backoff
+ * - Task3() retries try_lock_for(1s) forever
+ *      - A fixed long period reacts slowly
+ *      - A fixed short period floods the lock with attempts when many threads poll it
+ *
+ * - acquire_with_backoff(lockable, policy) calls try_lock()
+ *      - If that fails, it sleeps for policy.next_delay(), then tries again
+ *      - The policy decides how the delay grows
+ *      - Works with any type which has try_lock(), not only timed mutexes
+ *
+ * - An optional deadline limits the total time
+ *      - The last sleep is cut short at the deadline, then there is one last attempt
+ *
+ * - The result reports whether the lock was acquired, how many attempts it took and how long it waited
+ *      */
+
+/*
+ * Backoff policies
+ * - Each has next_delay(), the sleep before the next attempt
+ * - Passed by value: every acquire_with_backoff() call starts from the policy's initial state
+ *
+ * - ExponentialBackoff: initial, initial * factor, initial * factor^2, ...
+ *      - factor 1 gives a fixed period
+ * - DecorrelatedJitterBackoff: random, between base and three times the previous delay
+ *      - Threads which failed together do not all retry together
+ * - Capped<Policy>: any policy, with a maximum delay
+ * - A zero (or negative) initial or base delay is raised to one clock tick
+ *      - Zero would never grow, so the retries would spin on try_lock()
+ *      */
+
+using backoff_clock = std::chrono::steady_clock;
+
+inline backoff_clock::duration at_least_one_tick(backoff_clock::duration delay) {
+    return std::max(delay, backoff_clock::duration(1));
+}
+
+class ExponentialBackoff {
+public:
+    explicit ExponentialBackoff(backoff_clock::duration initial, double factor = 2.0)
+        : delay(at_least_one_tick(initial)), factor(factor) {}
+
+    backoff_clock::duration next_delay() {
+        auto current = delay;
+        // Stop growing before the next delay would overflow
+        if (delay.count() < backoff_clock::duration::max().count() / factor) {
+            delay = std::chrono::duration_cast<backoff_clock::duration>(delay * factor);
+        }
+        return current;
+    }
+
+private:
+    backoff_clock::duration delay;
+    double factor;
+};
+
+// One random number generator per thread, so copies of a policy do not share a sequence
+inline std::minstd_rand &backoff_random() {
+    thread_local std::minstd_rand engine(std::random_device{}());
+    return engine;
+}
+
+class DecorrelatedJitterBackoff {
+public:
+    // A cap below base is raised to base, so every delay is in [base, cap]
+    DecorrelatedJitterBackoff(backoff_clock::duration base, backoff_clock::duration cap)
+        : base(at_least_one_tick(base)), cap(std::max(this->base, cap)), previous(this->base) {}
+
+    backoff_clock::duration next_delay() {
+        std::uniform_int_distribution<backoff_clock::rep> dist(base.count(), previous.count() * 3);
+        previous = std::max(base, std::min(cap, backoff_clock::duration(dist(backoff_random()))));
+        return previous;
+    }
+
+private:
+    backoff_clock::duration base;
+    backoff_clock::duration cap;
+    backoff_clock::duration previous;
+};
+
+template <typename Policy>
+class Capped {
+public:
+    Capped(Policy policy, backoff_clock::duration max_delay) : policy(policy), max_delay(max_delay) {}
+
+    backoff_clock::duration next_delay() {
+        return std::min(policy.next_delay(), max_delay);
+    }
+
+private:
+    Policy policy;
+    backoff_clock::duration max_delay;
+};
+
+struct BackoffResult {
+    bool acquired {false};
+    int attempts {0};
+    backoff_clock::duration waited {0};
+
+    explicit operator bool() const { return acquired; }
+};
+
+template <typename Lockable, typename Policy>
+BackoffResult acquire_with_backoff(Lockable &lockable, Policy policy, backoff_clock::time_point deadline) {
+    BackoffResult result;
+    auto start = backoff_clock::now();
+    while (true) {
+        ++result.attempts;
+        if (lockable.try_lock()) {
+            result.acquired = true;
+            break;
+        }
+        auto now = backoff_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        std::this_thread::sleep_for(std::min(policy.next_delay(), deadline - now));
+    }
+    result.waited = backoff_clock::now() - start;
+    return result;
+}
+
+// No deadline: keep trying until the lock is acquired
+template <typename Lockable, typename Policy>
+BackoffResult acquire_with_backoff(Lockable &lockable, Policy policy) {
+    return acquire_with_backoff(lockable, policy, backoff_clock::time_point::max());
+}
+
+template <typename Lockable, typename Policy, typename Rep, typename Period>
+BackoffResult acquire_with_backoff(Lockable &lockable, Policy policy, const std::chrono::duration<Rep, Period> &timeout) {
+    return acquire_with_backoff(lockable, policy,
+                                backoff_clock::now() + std::chrono::duration_cast<backoff_clock::duration>(timeout));
+}
+
+#endif //LOCK_GAURD_BACKOFF_H
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "backoff.h"
+#include "spin_wait.h"
+
+using namespace std::literals;
+
+/*
+ * Backoff benchmark
+ * - 32 threads share one std::timed_mutex
+ *      - Each locks it, holds it briefly, unlocks, then does some work of its own
+ *
+ * - Ways to wait for it
+ *      - try_lock_for(1s) in a loop, as in Task3()
+ *      - acquire_with_backoff() with a fixed short period, and a fixed long period
+ *      - acquire_with_backoff() with capped exponential backoff
+ *      - acquire_with_backoff() with decorrelated jitter
+ *
+ * - Measured:
+ *      - Throughput: acquisitions per second, all threads together
+ *      - Latency: from starting to wait until the lock is held
+ *      - Attempts: try_lock() calls per acquisition
+ *
+ * - try_lock_for() is not polling: the thread sleeps in the kernel and is woken by unlock()
+ *      - It is the baseline for the polling policies
+ *
+ * Usage: backoff_bench [threads] [milliseconds per run]
+ *      */
+
+struct Measured {
+    double per_second;
+    long long p50_us;
+    long long p99_us;
+    double attempts;
+};
+
+template <typename Acquire>
+Measured run(unsigned nthreads, std::chrono::milliseconds run_time, Acquire acquire) {
+    std::timed_mutex the_mutex;
+    std::atomic<bool> stop {false};
+    std::atomic<long long> attempts {0};
+    std::vector<std::vector<long long>> latencies(nthreads);
+    std::vector<std::thread> threads;
+
+    for (unsigned t{0}; t < nthreads; ++t) {
+        threads.push_back(std::thread([&, t] {
+            long long my_attempts {0};
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto start = backoff_clock::now();
+                my_attempts += acquire(the_mutex);
+                auto waited = backoff_clock::now() - start;
+                latencies[t].push_back(std::chrono::duration_cast<std::chrono::microseconds>(waited).count());
+                // start of critical section
+                for (int i{0}; i < 2000; ++i) {
+                    cpu_relax();
+                }
+                // end of critical section
+                the_mutex.unlock();
+                std::this_thread::sleep_for(200us);
+            }
+            attempts += my_attempts;
+        }));
+    }
+
+    auto start = backoff_clock::now();
+    std::this_thread::sleep_for(run_time);
+    stop.store(true, std::memory_order_relaxed);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = backoff_clock::now() - start;
+
+    std::vector<long long> all;
+    for (auto &lat : latencies) {
+        all.insert(all.end(), lat.begin(), lat.end());
+    }
+    std::sort(all.begin(), all.end());
+    return {all.size() / elapsed.count(), all[all.size() / 2], all[all.size() * 99 / 100],
+            static_cast<double>(attempts) / all.size()};
+}
+
+void print(const std::string &name, Measured result) {
+    std::cout << std::setw(26) << std::left << name << std::right << std::setw(12) << result.per_second
+              << std::setw(10) << result.p50_us << std::setw(10) << result.p99_us
+              << std::setw(12) << result.attempts << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned nthreads = argc > 1 ? std::atoi(argv[1]) : 32;
+    auto run_time = std::chrono::milliseconds(argc > 2 ? std::atoi(argv[2]) : 1000);
+
+    std::cout << nthreads << " threads, one std::timed_mutex" << std::endl;
+    std::cout << std::setw(26) << std::left << "" << std::right << std::setw(12) << "acq/s"
+              << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(12) << "attempts" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    print("try_lock_for(1s) loop", run(nthreads, run_time, [](std::timed_mutex &mut) {
+        long long attempts {1};
+        while (!mut.try_lock_for(1s)) {
+            ++attempts;
+        }
+        return attempts;
+    }));
+    print("fixed 10us", run(nthreads, run_time, [](std::timed_mutex &mut) {
+        return acquire_with_backoff(mut, ExponentialBackoff(10us, 1.0)).attempts;
+    }));
+    print("fixed 5ms", run(nthreads, run_time, [](std::timed_mutex &mut) {
+        return acquire_with_backoff(mut, ExponentialBackoff(5ms, 1.0)).attempts;
+    }));
+    print("exponential 10us..2ms", run(nthreads, run_time, [](std::timed_mutex &mut) {
+        return acquire_with_backoff(mut, Capped<ExponentialBackoff>(ExponentialBackoff(10us), 2ms)).attempts;
+    }));
+    print("decorrelated jitter", run(nthreads, run_time, [](std::timed_mutex &mut) {
+        return acquire_with_backoff(mut, DecorrelatedJitterBackoff(10us, 2ms)).attempts;
+    }));
+
+    // Deadline: give up after 100us, while another thread holds the mutex
+    std::timed_mutex held;
+    std::atomic<bool> locked {false};
+    std::atomic<bool> done {false};
+    std::thread holder([&] {
+        std::lock_guard<std::timed_mutex> lck_guard(held);
+        locked = true;
+        while (!done) {
+            std::this_thread::yield();
+        }
+    });
+    while (!locked) {
+        std::this_thread::yield();
+    }
+    auto result = acquire_with_backoff(held, ExponentialBackoff(10us), 100us);
+    done = true;
+    holder.join();
+    std::cout << "deadline 100us: acquired " << std::boolalpha << result.acquired << " after " << result.attempts
+              << " attempts, "
+              << std::chrono::duration_cast<std::chrono::microseconds>(result.waited).count() << " us" << std::endl;
+    return 0;
+}
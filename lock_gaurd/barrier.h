@@ -0,0 +1,247 @@
+#ifndef LOCK_GAURD_BARRIER_H
+#define LOCK_GAURD_BARRIER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "futex.h"
+#include "spin_wait.h"
+
+/*
+ * Latch and Barrier
+ * - C++20 has std::latch and std::barrier, but this project is C++17
+ *
+ * - The demos coordinate phases by join()-ing all the threads, then starting new ones
+ *      - Creating and destroying threads is expensive
+ *      - An iterative algorithm would do that on every iteration
+ *
+ * - Latch: a one-shot countdown
+ *      - count_down() decrements the counter
+ *      - wait() blocks until it reaches zero
+ *      - Cannot be reused
+ *
+ * - Barrier: a reusable meeting point for a fixed number of threads
+ *      - arrive_and_wait() blocks until every thread has arrived
+ *      - Then all of them are released, and the barrier is ready for the next phase
+ *      - An optional completion function runs once per phase
+ *      - It runs on the last thread to arrive, before the others are released
+ *      */
+
+/*
+ * Waiting: spin, then park
+ * - Phases are often short, so a waiter first spins on the phase word
+ * - If the phase does not change soon, it sleeps with futex_wait()
+ * - The thread which completes the phase only calls futex_wake() if somebody is asleep
+ *
+ * - With more threads than cores, spinning only delays the threads which have not arrived
+ *      - Then waiters go straight to sleep
+ * */
+
+inline int barrier_spin_limit(std::uint32_t nthreads) {
+    return nthreads <= std::thread::hardware_concurrency() ? 2000 : 0;
+}
+
+// Wait until word != value: spin first, then sleep
+inline void spin_then_park(std::atomic<std::uint32_t> &word, std::uint32_t value,
+                           std::atomic<std::uint32_t> &sleepers, int spin_limit) {
+    for (int i{0}; i < spin_limit; ++i) {
+        if (word.load(std::memory_order_acquire) != value) {
+            return;
+        }
+        cpu_relax();
+    }
+    // seq_cst pairs with wake_sleepers(): either it sees us, or we see the new value
+    sleepers.fetch_add(1, std::memory_order_seq_cst);
+    while (word.load(std::memory_order_seq_cst) == value) {
+        futex_wait(word, value);
+    }
+    sleepers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+inline void wake_sleepers(std::atomic<std::uint32_t> &word, std::atomic<std::uint32_t> &sleepers) {
+    if (sleepers.load(std::memory_order_seq_cst) != 0) {
+        futex_wake_all(word);
+    }
+}
+
+class Latch {
+public:
+    explicit Latch(std::uint32_t count) : count(count), spin_limit(barrier_spin_limit(count)) {}
+    Latch(const Latch &source) = delete;
+    Latch &operator=(const Latch &source) = delete;
+
+    void count_down(std::uint32_t n = 1) {
+        if (count.fetch_sub(n, std::memory_order_seq_cst) == n) {
+            wake_sleepers(count, sleepers);
+        }
+    }
+
+    bool try_wait() const {
+        return count.load(std::memory_order_acquire) == 0;
+    }
+
+    void wait() {
+        while (true) {
+            auto current = count.load(std::memory_order_acquire);
+            if (current == 0) {
+                return;
+            }
+            spin_then_park(count, current, sleepers, spin_limit);
+        }
+    }
+
+    void arrive_and_wait(std::uint32_t n = 1) {
+        count_down(n);
+        wait();
+    }
+
+private:
+    std::atomic<std::uint32_t> count;
+    std::atomic<std::uint32_t> sleepers {0};
+    int spin_limit;
+};
+
+struct NoCompletion {
+    void operator()() {}
+};
+
+/*
+ * Barrier: centralized, sense-reversing
+ * - One counter of threads still to arrive, and a phase number
+ *      - Each arriving thread decrements the counter
+ *      - The last one resets the counter and increments the phase
+ *      - The others wait for the phase to change
+ * - The phase number is a generalised "sense"
+ *      - The counter can be reset before anybody leaves, so the barrier is reusable at once
+ *      */
+
+template <typename CompletionFunction = NoCompletion>
+class Barrier {
+public:
+    explicit Barrier(std::uint32_t nthreads, CompletionFunction completion = CompletionFunction())
+        : nthreads(nthreads), spin_limit(barrier_spin_limit(nthreads)), remaining(nthreads),
+          completion(std::move(completion)) {}
+
+    Barrier(const Barrier &source) = delete;
+    Barrier &operator=(const Barrier &source) = delete;
+
+    void arrive_and_wait() {
+        auto my_phase = phase.load(std::memory_order_acquire);
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            complete_phase(my_phase);
+        }
+        else {
+            spin_then_park(phase, my_phase, sleepers, spin_limit);
+        }
+    }
+
+private:
+    void complete_phase(std::uint32_t my_phase) {
+        completion();
+        remaining.store(nthreads, std::memory_order_relaxed);
+        phase.store(my_phase + 1, std::memory_order_seq_cst);
+        wake_sleepers(phase, sleepers);
+    }
+
+    const std::uint32_t nthreads;
+    const int spin_limit;
+    alignas(64) std::atomic<std::uint32_t> remaining;
+    alignas(64) std::atomic<std::uint32_t> phase {0};
+    std::atomic<std::uint32_t> sleepers {0};
+    CompletionFunction completion;
+};
+
+/*
+ * TreeBarrier: combining tree, for large thread counts
+ * - With a central counter, every thread does a read-modify-write on the same word
+ *      - With 100 threads, that cache line is passed around 100 times per phase
+ *
+ * - The tree splits the counter into nodes, each shared by at most "fan_in" threads
+ *      - A thread arrives at its leaf node
+ *      - The last thread to arrive at a node carries on to the parent node
+ *      - The last thread to arrive at the root completes the phase
+ *
+ * - Each thread must pass its own index, 0 to nthreads - 1
+ *      - The index decides which leaf it arrives at
+ *      */
+
+template <typename CompletionFunction = NoCompletion>
+class TreeBarrier {
+public:
+    explicit TreeBarrier(std::uint32_t nthreads, CompletionFunction completion = CompletionFunction())
+        : spin_limit(barrier_spin_limit(nthreads)), completion(std::move(completion)) {
+        // Leaves first, then each level above them, the root last
+        // 0 threads is treated as 1; otherwise no level would ever have one node
+        std::uint32_t children = std::max<std::uint32_t>(nthreads, 1);
+        std::size_t prev_begin {0};
+        std::size_t prev_end {0};
+        while (true) {
+            std::uint32_t level_size = (children + fan_in - 1) / fan_in;
+            std::size_t begin = nodes.size();
+            for (std::uint32_t i{0}; i < level_size; ++i) {
+                nodes.emplace_back(std::min(fan_in, children - i * fan_in));
+            }
+            // Link the level below to this one
+            for (std::size_t i{prev_begin}; i < prev_end; ++i) {
+                nodes[i].parent = begin + (i - prev_begin) / fan_in;
+            }
+            prev_begin = begin;
+            prev_end = nodes.size();
+            if (level_size == 1) {
+                break;
+            }
+            children = level_size;
+        }
+    }
+
+    TreeBarrier(const TreeBarrier &source) = delete;
+    TreeBarrier &operator=(const TreeBarrier &source) = delete;
+
+    void arrive_and_wait(std::uint32_t thread_index) {
+        auto my_phase = phase.load(std::memory_order_acquire);
+        std::size_t node = thread_index / fan_in;
+        while (true) {
+            auto &current = nodes[node];
+            if (current.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                // Not the last at this node - wait for the whole phase
+                spin_then_park(phase, my_phase, sleepers, spin_limit);
+                return;
+            }
+            // Last at this node: reset it for the next phase, and go up
+            current.remaining.store(current.expected, std::memory_order_relaxed);
+            if (current.parent == no_parent) {
+                break;
+            }
+            node = current.parent;
+        }
+        completion();
+        phase.store(my_phase + 1, std::memory_order_seq_cst);
+        wake_sleepers(phase, sleepers);
+    }
+
+private:
+    static constexpr std::uint32_t fan_in {4};
+    static constexpr std::size_t no_parent {static_cast<std::size_t>(-1)};
+
+    struct alignas(64) Node {
+        explicit Node(std::uint32_t expected) : expected(expected), remaining(expected) {}
+        Node(Node &&source) noexcept
+            : expected(source.expected), remaining(source.remaining.load()), parent(source.parent) {}
+
+        std::uint32_t expected;
+        std::atomic<std::uint32_t> remaining;
+        std::size_t parent {no_parent};
+    };
+
+    std::vector<Node> nodes;
+    int spin_limit;
+    alignas(64) std::atomic<std::uint32_t> phase {0};
+    std::atomic<std::uint32_t> sleepers {0};
+    CompletionFunction completion;
+};
+
+#endif //LOCK_GAURD_BARRIER_H
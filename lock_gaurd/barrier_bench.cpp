@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "barrier.h"
+
+using namespace std::literals;
+
+/*
+ * Barrier benchmark
+ * - Round-trip latency of one phase: every thread arrives, and every thread is released
+ * - From 2 threads up to 128
+ *
+ * - Barrier: centralized, sense-reversing
+ * - TreeBarrier: combining tree
+ * - CvBarrier: a count and a generation protected by a mutex and condition variable
+ * - Respawn: what the demos do - start the threads, then join() them, once per phase
+ *
+ * - A completion function counts the phases, to check nobody was left behind
+ *
+ * Usage: barrier_bench [max threads] [phases]
+ *      */
+
+class CvBarrier {
+public:
+    explicit CvBarrier(std::uint32_t nthreads) : nthreads(nthreads), remaining(nthreads) {}
+
+    void arrive_and_wait() {
+        std::unique_lock<std::mutex> uniq_lck(mut);
+        auto my_generation = generation;
+        if (--remaining == 0) {
+            remaining = nthreads;
+            ++generation;
+            uniq_lck.unlock();
+            cv.notify_all();
+            return;
+        }
+        cv.wait(uniq_lck, [this, my_generation] { return generation != my_generation; });
+    }
+
+private:
+    std::mutex mut;
+    std::condition_variable cv;
+    std::uint32_t nthreads;
+    std::uint32_t remaining;
+    std::uint64_t generation {0};
+};
+
+struct CountPhases {
+    long *phases;
+    void operator()() { ++*phases; }
+};
+
+// Runs "phases" phases on nthreads threads, returns nanoseconds per phase
+template <typename ArriveAndWait>
+double ns_per_phase(unsigned nthreads, int phases, ArriveAndWait arrive_and_wait) {
+    Latch ready(nthreads + 1);
+    std::vector<std::thread> threads;
+    for (unsigned t{0}; t < nthreads; ++t) {
+        threads.push_back(std::thread([&, t] {
+            ready.arrive_and_wait();
+            for (int p{0}; p < phases; ++p) {
+                arrive_and_wait(t);
+            }
+        }));
+    }
+    ready.arrive_and_wait();
+    auto start = std::chrono::steady_clock::now();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / phases;
+}
+
+double respawn_ns_per_phase(unsigned nthreads, int phases) {
+    auto start = std::chrono::steady_clock::now();
+    for (int p{0}; p < phases; ++p) {
+        std::vector<std::thread> threads;
+        for (unsigned t{0}; t < nthreads; ++t) {
+            threads.push_back(std::thread([] {}));
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / phases;
+}
+
+void check(long phases, int expected) {
+    if (phases != expected) {
+        std::cerr << "completion ran " << phases << " times, expected " << expected << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned max_threads = argc > 1 ? std::atoi(argv[1]) : 128;
+    int phases = argc > 2 ? std::atoi(argv[2]) : 2000;
+    int respawn_phases = std::max(1, phases / 20);
+
+    std::cout << "ns per phase (" << phases << " phases)" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "Barrier" << std::setw(14) << "TreeBarrier"
+              << std::setw(12) << "CvBarrier" << std::setw(12) << "respawn" << std::endl;
+    std::cout << std::fixed << std::setprecision(0);
+    for (unsigned n{2}; n <= max_threads; n *= 2) {
+        long central_phases {0};
+        Barrier<CountPhases> central(n, CountPhases{&central_phases});
+        auto central_ns = ns_per_phase(n, phases, [&central](unsigned) { central.arrive_and_wait(); });
+        check(central_phases, phases);
+
+        long tree_phases {0};
+        TreeBarrier<CountPhases> tree(n, CountPhases{&tree_phases});
+        auto tree_ns = ns_per_phase(n, phases, [&tree](unsigned t) { tree.arrive_and_wait(t); });
+        check(tree_phases, phases);
+
+        CvBarrier cv_barrier(n);
+        auto cv_ns = ns_per_phase(n, phases, [&cv_barrier](unsigned) { cv_barrier.arrive_and_wait(); });
+
+        std::cout << std::setw(8) << n << std::setw(12) << central_ns << std::setw(14) << tree_ns
+                  << std::setw(12) << cv_ns << std::setw(12) << respawn_ns_per_phase(n, respawn_phases) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,335 @@
+#ifndef LOCK_GAURD_BASIC_LOCK_H
+#define LOCK_GAURD_BASIC_LOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <type_traits>
+
+#include "futex.h"
+#include "spin_wait.h"
+
+/*
+ * BasicLock<WaitPolicy, StatsPolicy>
+ * - One mutex template, instead of a separate class for each kind of waiting
+ *      - The wait policy decides what a thread does when the lock is taken
+ *      - The stats policy decides what is recorded about each acquisition
+ *      - Both are chosen at compile time, as template arguments
+ *
+ * - Wait policies
+ *      - SpinPolicy: keep re-reading the lock word
+ *      - SpinYieldPolicy: spin for a while, then yield the processor
+ *      - FutexParkPolicy: sleep in the kernel until unlock() wakes us
+ *      - HybridPolicy: spin for a while, then sleep
+ *
+ * - Stats policies
+ *      - NoStats: nothing at all
+ *      - CounterStats: acquisitions, contended acquisitions, total wait time
+ *      - HistogramStats: as CounterStats, plus a log2 histogram of wait times
+ *      */
+
+/*
+ * Zero cost when unused
+ * - NoStats is an empty class, and BasicLock derives from the stats policy
+ *      - Empty base optimization: BasicLock<..., NoStats> is just one 32-bit word
+ * - "if constexpr" removes the clock reads when the stats policy is not enabled
+ * - The spin policies never call into the kernel
+ *      - Their unlock() is a single store
+ *
+ * - Stats are only updated by the thread which holds the lock
+ *      - So they are plain loads and stores, not atomic read-modify-writes
+ *      */
+
+/*
+ * Drop-in replacement
+ * - lock(), try_lock(), unlock(), try_lock_for(), try_lock_until()
+ *      - Usable wherever std::mutex or std::timed_mutex is
+ *      - std::lock_guard, std::unique_lock, std::scoped_lock, std::lock()
+ *
+ * - Changing print_mutex or the_mutex only needs a type change
+ *      BasicLock<HybridPolicy, NoStats> print_mutex;
+ *      std::unique_lock<BasicLock<HybridPolicy, NoStats>> uniq_lck(print_mutex);
+ *      */
+
+// Lock word: 0 = unlocked, 1 = locked, 2 = locked and a thread may be asleep
+using LockWord = std::atomic<std::uint32_t>;
+
+inline bool try_acquire_word(LockWord &word) {
+    std::uint32_t expected {0};
+    return word.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+// Convert any clock's deadline to steady_clock
+template <typename Clock, typename Duration>
+std::chrono::steady_clock::time_point to_steady_deadline(const std::chrono::time_point<Clock, Duration> &deadline) {
+    if constexpr (std::is_same_v<Clock, std::chrono::steady_clock>) {
+        return std::chrono::time_point_cast<std::chrono::steady_clock::duration>(deadline);
+    }
+    else {
+        return std::chrono::steady_clock::now()
+               + std::chrono::duration_cast<std::chrono::steady_clock::duration>(deadline - Clock::now());
+    }
+}
+
+struct SpinPolicy {
+    static constexpr const char *name {"spin"};
+
+    static void wait(LockWord &word) {
+        do {
+            // Read-only spin, so the cache line is not written until it is free
+            while (word.load(std::memory_order_relaxed) != 0) {
+                cpu_relax();
+            }
+        } while (!try_acquire_word(word));
+    }
+
+    static bool wait_until(LockWord &word, std::chrono::steady_clock::time_point deadline) {
+        while (!try_acquire_word(word)) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            for (int i{0}; i < 64 && word.load(std::memory_order_relaxed) != 0; ++i) {
+                cpu_relax();
+            }
+        }
+        return true;
+    }
+
+    static void release(LockWord &word) {
+        word.store(0, std::memory_order_release);
+    }
+};
+
+struct SpinYieldPolicy {
+    static constexpr const char *name {"spin-yield"};
+
+    static void wait(LockWord &word) {
+        SpinWait spin;
+        do {
+            while (word.load(std::memory_order_relaxed) != 0) {
+                spin.wait();
+            }
+        } while (!try_acquire_word(word));
+    }
+
+    static bool wait_until(LockWord &word, std::chrono::steady_clock::time_point deadline) {
+        SpinWait spin;
+        while (!try_acquire_word(word)) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            spin.wait();
+        }
+        return true;
+    }
+
+    static void release(LockWord &word) {
+        word.store(0, std::memory_order_release);
+    }
+};
+
+struct FutexParkPolicy {
+    static constexpr const char *name {"futex"};
+
+    static void wait(LockWord &word) {
+        // Mark the lock as contended, so unlock() knows to wake somebody
+        while (word.exchange(2, std::memory_order_acquire) != 0) {
+            futex_wait(word, 2);
+        }
+    }
+
+    static bool wait_until(LockWord &word, std::chrono::steady_clock::time_point deadline) {
+        while (word.exchange(2, std::memory_order_acquire) != 0) {
+            if (!futex_wait_until(word, 2, deadline)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void release(LockWord &word) {
+        if (word.exchange(0, std::memory_order_release) == 2) {
+            futex_wake(word, 1);
+        }
+    }
+};
+
+struct HybridPolicy {
+    static constexpr const char *name {"hybrid"};
+    static constexpr int spin_limit {100};
+
+    static bool spin(LockWord &word) {
+        for (int i{0}; i < spin_limit; ++i) {
+            if (word.load(std::memory_order_relaxed) == 0 && try_acquire_word(word)) {
+                return true;
+            }
+            cpu_relax();
+        }
+        return false;
+    }
+
+    static void wait(LockWord &word) {
+        if (!spin(word)) {
+            FutexParkPolicy::wait(word);
+        }
+    }
+
+    static bool wait_until(LockWord &word, std::chrono::steady_clock::time_point deadline) {
+        return spin(word) || FutexParkPolicy::wait_until(word, deadline);
+    }
+
+    static void release(LockWord &word) {
+        FutexParkPolicy::release(word);
+    }
+};
+
+struct NoStats {
+    static constexpr bool enabled {false};
+    static constexpr const char *name {"none"};
+
+    void record(bool, std::chrono::nanoseconds) {}
+};
+
+class CounterStats {
+public:
+    static constexpr bool enabled {true};
+    static constexpr const char *name {"counters"};
+
+    // Only called by the thread which holds the lock
+    void record(bool contended, std::chrono::nanoseconds waited) {
+        bump(acquisition_count, 1);
+        if (contended) {
+            bump(contended_count, 1);
+            bump(wait_ns, waited.count());
+        }
+    }
+
+    std::uint64_t acquisitions() const { return acquisition_count.load(std::memory_order_relaxed); }
+    std::uint64_t contended() const { return contended_count.load(std::memory_order_relaxed); }
+    std::chrono::nanoseconds total_wait() const {
+        return std::chrono::nanoseconds(wait_ns.load(std::memory_order_relaxed));
+    }
+
+    void print(std::ostream &os) const {
+        os << "acquisitions " << acquisitions() << ", contended " << contended()
+           << ", total wait " << total_wait().count() / 1000 << " us" << std::endl;
+    }
+
+protected:
+    static void bump(std::atomic<std::uint64_t> &counter, std::uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::uint64_t> acquisition_count {0};
+    std::atomic<std::uint64_t> contended_count {0};
+    std::atomic<std::uint64_t> wait_ns {0};
+};
+
+class HistogramStats : public CounterStats {
+public:
+    static constexpr const char *name {"histogram"};
+    // Bucket i counts waits of [2^i, 2^(i+1)) ns, bucket 0 includes uncontended acquisitions
+    static constexpr int nbuckets {40};
+
+    void record(bool contended, std::chrono::nanoseconds waited) {
+        CounterStats::record(contended, waited);
+        int bucket {0};
+        for (auto ns = static_cast<std::uint64_t>(waited.count()); ns > 1 && bucket < nbuckets - 1; ns >>= 1) {
+            ++bucket;
+        }
+        bump(buckets[bucket], 1);
+    }
+
+    std::uint64_t bucket(int i) const { return buckets[i].load(std::memory_order_relaxed); }
+
+    void print(std::ostream &os) const {
+        CounterStats::print(os);
+        for (int i{0}; i < nbuckets; ++i) {
+            if (bucket(i) != 0) {
+                os << "  < " << (std::uint64_t{2} << i) << " ns: " << bucket(i) << std::endl;
+            }
+        }
+    }
+
+private:
+    std::atomic<std::uint64_t> buckets[nbuckets] {};
+};
+
+template <typename WaitPolicy, typename StatsPolicy = NoStats>
+class BasicLock : private StatsPolicy {
+public:
+    using wait_policy = WaitPolicy;
+    using stats_policy = StatsPolicy;
+
+    BasicLock() = default;
+    BasicLock(const BasicLock &source) = delete;
+    BasicLock &operator=(const BasicLock &source) = delete;
+
+    void lock() {
+        if (try_acquire_word(word)) {
+            record(false, std::chrono::nanoseconds::zero());
+            return;
+        }
+        if constexpr (StatsPolicy::enabled) {
+            auto start = std::chrono::steady_clock::now();
+            WaitPolicy::wait(word);
+            record(true, std::chrono::steady_clock::now() - start);
+        }
+        else {
+            WaitPolicy::wait(word);
+        }
+    }
+
+    bool try_lock() {
+        if (!try_acquire_word(word)) {
+            return false;
+        }
+        record(false, std::chrono::nanoseconds::zero());
+        return true;
+    }
+
+    template <typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period> &timeout) {
+        return try_lock_until(std::chrono::steady_clock::now() + timeout);
+    }
+
+    template <typename Clock, typename Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration> &deadline) {
+        if (try_acquire_word(word)) {
+            record(false, std::chrono::nanoseconds::zero());
+            return true;
+        }
+        if constexpr (StatsPolicy::enabled) {
+            auto start = std::chrono::steady_clock::now();
+            if (!WaitPolicy::wait_until(word, to_steady_deadline(deadline))) {
+                return false;
+            }
+            record(true, std::chrono::steady_clock::now() - start);
+            return true;
+        }
+        else {
+            return WaitPolicy::wait_until(word, to_steady_deadline(deadline));
+        }
+    }
+
+    void unlock() {
+        WaitPolicy::release(word);
+    }
+
+    const StatsPolicy &stats() const { return *this; }
+
+private:
+    template <typename Duration>
+    void record(bool contended, Duration waited) {
+        if constexpr (StatsPolicy::enabled) {
+            StatsPolicy::record(contended, std::chrono::duration_cast<std::chrono::nanoseconds>(waited));
+        }
+    }
+
+    LockWord word {0};
+};
+
+#endif //LOCK_GAURD_BASIC_LOCK_H
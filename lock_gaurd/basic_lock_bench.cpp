@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "basic_lock.h"
+
+using namespace std::literals;
+
+/*
+ * BasicLock benchmark
+ * - Every wait policy with every stats policy, plus std::mutex
+ * - Each thread locks, increments a shared counter, and unlocks
+ * - Reported: size of the lock object and throughput (Mops/s)
+ *
+ * - Also runs task()-style and Task3()-style code with a BasicLock
+ *      - Only the mutex type is different from main.cpp
+ *
+ * Usage: basic_lock_bench [threads] [milliseconds per run]
+ *      */
+
+// The stats policy adds no storage when it is not used
+static_assert(sizeof(BasicLock<SpinPolicy, NoStats>) == sizeof(std::uint32_t));
+static_assert(sizeof(BasicLock<FutexParkPolicy, NoStats>) == sizeof(std::uint32_t));
+
+template <typename Lock>
+double ops_per_second(Lock &lock, unsigned nthreads, std::chrono::milliseconds run_time) {
+    long long counter {0};
+    std::atomic<bool> start {false};
+    std::atomic<bool> stop {false};
+    std::vector<std::thread> threads;
+
+    for (unsigned t{0}; t < nthreads; ++t) {
+        threads.push_back(std::thread([&] {
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            while (!stop.load(std::memory_order_relaxed)) {
+                std::lock_guard<Lock> lck_guard(lock);
+                ++counter;
+            }
+        }));
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(run_time);
+    stop.store(true, std::memory_order_relaxed);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return counter / elapsed.count();
+}
+
+void print_row(const std::string &wait, const std::string &stats, std::size_t size, double ops) {
+    std::cout << std::setw(12) << wait << std::setw(12) << stats << std::setw(8) << size
+              << std::setw(10) << std::fixed << std::setprecision(2) << ops / 1e6 << std::endl;
+}
+
+template <typename WaitPolicy, typename StatsPolicy>
+void bench_one(unsigned nthreads, std::chrono::milliseconds run_time) {
+    BasicLock<WaitPolicy, StatsPolicy> lock;
+    auto ops = ops_per_second(lock, nthreads, run_time);
+    print_row(WaitPolicy::name, StatsPolicy::name, sizeof(lock), ops);
+    if constexpr (std::is_same_v<StatsPolicy, HistogramStats>) {
+        lock.stats().print(std::cout);
+    }
+}
+
+template <typename WaitPolicy>
+void bench_wait_policy(unsigned nthreads, std::chrono::milliseconds run_time) {
+    bench_one<WaitPolicy, NoStats>(nthreads, run_time);
+    bench_one<WaitPolicy, CounterStats>(nthreads, run_time);
+    bench_one<WaitPolicy, HistogramStats>(nthreads, run_time);
+}
+
+// task() and Task3() from main.cpp, with only the mutex type changed
+BasicLock<HybridPolicy, NoStats> print_mutex;
+BasicLock<FutexParkPolicy, CounterStats> the_mutex;
+
+void task(std::string str) {
+    for (int i{0}; i < 5; ++i) {
+        std::unique_lock<BasicLock<HybridPolicy, NoStats>> uniq_lck(print_mutex);
+        std::cout << str[0] << str[1] << str[2] << std::endl;
+        uniq_lck.unlock();
+        std::this_thread::sleep_for(5ms);
+    }
+}
+
+void task1() {
+    std::lock_guard<BasicLock<FutexParkPolicy, CounterStats>> lck_guard(the_mutex);
+    std::this_thread::sleep_for(250ms);
+}
+
+void Task3() {
+    std::this_thread::sleep_for(20ms);
+    std::unique_lock<BasicLock<FutexParkPolicy, CounterStats>> uniq_lck(the_mutex, std::defer_lock);
+    while (!uniq_lck.try_lock_for(100ms)) {
+        std::cout << "Task3 could not lock the mutex" << std::endl;
+    }
+    std::cout << "Task3 has locked the mutex" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned nthreads = argc > 1 ? std::atoi(argv[1]) : std::max(2u, std::thread::hardware_concurrency());
+    auto run_time = std::chrono::milliseconds(argc > 2 ? std::atoi(argv[2]) : 300);
+
+    std::cout << nthreads << " threads, " << run_time.count() << " ms per run" << std::endl;
+    std::cout << std::setw(12) << "wait" << std::setw(12) << "stats" << std::setw(8) << "bytes"
+              << std::setw(10) << "Mops/s" << std::endl;
+    {
+        std::mutex mut;
+        print_row("std::mutex", "-", sizeof(mut), ops_per_second(mut, nthreads, run_time));
+    }
+    bench_wait_policy<SpinPolicy>(nthreads, run_time);
+    bench_wait_policy<SpinYieldPolicy>(nthreads, run_time);
+    bench_wait_policy<FutexParkPolicy>(nthreads, run_time);
+    bench_wait_policy<HybridPolicy>(nthreads, run_time);
+
+    std::cout << std::endl << "Drop-in replacement for print_mutex and the_mutex:" << std::endl;
+    std::thread thr1(task, "abc");
+    std::thread thr2(task, "def");
+    thr1.join(); thr2.join();
+
+    std::thread v1(task1);
+    std::thread v2(Task3);
+    v1.join(), v2.join();
+    std::cout << "the_mutex: ";
+    the_mutex.stats().print(std::cout);
+    return 0;
+}
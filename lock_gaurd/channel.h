@@ -0,0 +1,546 @@
+#ifndef LOCK_GAURD_CHANNEL_H
+#define LOCK_GAURD_CHANNEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "eventcount.h"
+#include "spin_wait.h"
+
+/*
+ * Channel
+ * - The threads here only communicate through shared variables and mutexes
+ * - A channel passes values from senders to receivers, like a Go channel
+ *      - Any number of threads may send, and any number may receive ("MPMC")
+ *      - Bounded: it holds at most "capacity" values, then senders wait
+ *
+ * - send(v) waits while the channel is full, recv(v) waits while it is empty
+ *      - try_send(v) and try_recv(v) return straight away: ok, full/empty, or closed
+ *      - send_batch(first, last) and recv_batch(out, max) move many values for one
+ *        compare_exchange, when there is room; send_batch needs forward iterators
+ *
+ * - Moving a value into or out of a slot must not throw
+ *      - A slot which has been claimed but never filled would block the ring for good
+ *      - So T's move constructor and move assignment must be noexcept (checked at compile time)
+ *      - try_send(const T &) copies the value before it claims a slot, so that copy may throw
+ *      - try_send(T &&) only moves from the value when it returns ok, so it can be retried with the same value
+ *      - send_batch constructs each slot from *first, which must not throw either (also checked)
+ *
+ * - close()
+ *      - Later sends fail, and return false (the value is not sent)
+ *      - Receivers still get every value which was sent before close()
+ *      - Then recv() returns false
+ *
+ * - Select waits on several channels at once, without polling; see below
+ *
+ * - The values are kept in a ring of slots, each with a sequence number (Dmitry Vyukov's bounded MPMC queue)
+ *      - A sender claims the slot at "tail" with compare_exchange, once its sequence number says it is free
+ *      - It writes the value, then sets the sequence number to say it is full
+ *      - Receivers do the same from "head"
+ *      - No lock: a sender and a receiver only meet on a slot's sequence number
+ *      - close() sets the top bit of "tail", so that a sender's compare_exchange fails from then on
+ *
+ * - A blocked sender or receiver spins and yields for a moment, then sleeps on an EventCount
+ *      - A successful send or recv calls notify(), which is only a fence and a load when nobody sleeps
+ *      */
+
+enum class ChannelStatus { ok, full, empty, closed };
+
+class Select;
+
+namespace channel_detail {
+    // Where a Select sleeps; each channel it waits on holds a pointer to it
+    struct SelectWaiter {
+        EventCount event;
+    };
+
+    // The part of a channel which Select needs, for channels of any type
+    class ChannelBase {
+    public:
+        ChannelBase() = default;
+        ChannelBase(const ChannelBase &source) = delete;
+        ChannelBase &operator=(const ChannelBase &source) = delete;
+
+    protected:
+        friend class ::Select;
+
+        void add_selector(SelectWaiter *waiter) {
+            std::lock_guard<std::mutex> lck_guard(selectors_mutex);
+            selectors.push_back(waiter);
+            nselectors.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        void remove_selector(SelectWaiter *waiter) {
+            std::lock_guard<std::mutex> lck_guard(selectors_mutex);
+            selectors.erase(std::find(selectors.begin(), selectors.end(), waiter));
+            nselectors.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // Only after a seq_cst fence which follows the change, e.g. the one in EventCount::notify()
+        void notify_selectors() {
+            if (nselectors.load(std::memory_order_relaxed) != 0) {
+                std::lock_guard<std::mutex> lck_guard(selectors_mutex);
+                for (auto *waiter : selectors) {
+                    waiter->event.notify();
+                }
+            }
+        }
+
+    private:
+        std::atomic<int> nselectors {0};
+        std::mutex selectors_mutex;
+        std::vector<SelectWaiter *> selectors;
+    };
+}
+
+template <typename T>
+class Channel : public channel_detail::ChannelBase {
+    static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T>,
+                  "Channel<T>: a throwing move would leave a claimed slot unpublished");
+
+public:
+    // The capacity is rounded up to a power of two
+    explicit Channel(std::size_t capacity) : mask(round_up(capacity) - 1), slots(new Slot[mask + 1]) {
+        for (std::size_t i{0}; i <= mask; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // No other thread may be using the channel
+    ~Channel() {
+        std::size_t end = tail.load(std::memory_order_relaxed) & ~closed_bit;
+        for (std::size_t pos = head.load(std::memory_order_relaxed); pos != end; ++pos) {
+            slots[pos & mask].get()->~T();
+        }
+    }
+
+    std::size_t capacity() const { return mask + 1; }
+
+    ChannelStatus try_send(const T &value) {
+        T copy(value);
+        return try_push(std::move(copy));
+    }
+    ChannelStatus try_send(T &&value) { return try_push(std::move(value)); }
+
+    ChannelStatus try_recv(T &out) {
+        std::size_t pos = head.load(std::memory_order_relaxed);
+        while (true) {
+            Slot &slot = slots[pos & mask];
+            std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(sequence - (pos + 1));
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(*slot.get());
+                    slot.get()->~T();
+                    slot.sequence.store(pos + mask + 1, std::memory_order_release);
+                    not_full.notify();
+                    notify_selectors();
+                    return ChannelStatus::ok;
+                }
+            }
+            else if (diff < 0) {
+                return is_drained(pos) ? ChannelStatus::closed : ChannelStatus::empty;
+            }
+            else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // false if the channel was closed; the value is not sent
+    template <typename U>
+    bool send(U &&value) {
+        // One copy (or move) for every retry: try_push() only moves from it once it has a slot
+        T item(std::forward<U>(value));
+        while (true) {
+            auto status = try_push(std::move(item));
+            if (status != ChannelStatus::full) {
+                return status == ChannelStatus::ok;
+            }
+            wait_while(not_full, [this] { return full(); });
+        }
+    }
+
+    // false once the channel is closed and empty
+    bool recv(T &out) {
+        while (true) {
+            auto status = try_recv(out);
+            if (status != ChannelStatus::empty) {
+                return status == ChannelStatus::ok;
+            }
+            wait_while(not_empty, [this] { return empty(); });
+        }
+    }
+
+    // Sends [first, last), waiting for room as needed; returns the end of what was sent,
+    // which is before last only if the channel was closed
+    template <typename ForwardIt>
+    ForwardIt send_batch(ForwardIt first, ForwardIt last) {
+        static_assert(std::is_nothrow_constructible_v<T, typename std::iterator_traits<ForwardIt>::reference>,
+                      "Channel<T>::send_batch: constructing a T from *first must not throw");
+        auto remaining = static_cast<std::size_t>(std::distance(first, last));
+        while (remaining != 0) {
+            std::size_t sent {0};
+            if (try_push_batch(first, remaining, sent) == ChannelStatus::closed) {
+                break;
+            }
+            if (sent == 0) {
+                wait_while(not_full, [this] { return full(); });
+            }
+            remaining -= sent;
+        }
+        return first;
+    }
+
+    // Waits for at least one value, then takes up to max without waiting; returns how many
+    // 0 means the channel is closed and empty; assigning through out must not throw
+    template <typename OutputIt>
+    std::size_t recv_batch(OutputIt out, std::size_t max) {
+        while (max != 0) {
+            std::size_t received {0};
+            auto status = try_pop_batch(out, max, received);
+            if (received != 0) {
+                return received;
+            }
+            if (status == ChannelStatus::closed) {
+                return 0;
+            }
+            wait_while(not_empty, [this] { return empty(); });
+        }
+        return 0;
+    }
+
+    void close() {
+        tail.fetch_or(closed_bit, std::memory_order_acq_rel);
+        not_empty.notify_all();
+        not_full.notify_all();
+        notify_selectors();
+    }
+
+    bool closed() const { return (tail.load(std::memory_order_acquire) & closed_bit) != 0; }
+
+private:
+    static constexpr int spin_limit {64};
+    static constexpr std::size_t closed_bit {std::size_t{1} << (sizeof(std::size_t) * 8 - 1)};
+
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *get() { return std::launder(reinterpret_cast<T *>(storage)); }
+    };
+
+    static std::size_t round_up(std::size_t n) {
+        std::size_t power {2};
+        while (power < n) {
+            power *= 2;
+        }
+        return power;
+    }
+
+    ChannelStatus try_push(T &&value) {
+        std::size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            if (pos & closed_bit) {
+                return ChannelStatus::closed;
+            }
+            Slot &slot = slots[pos & mask];
+            std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(sequence - pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    new (slot.storage) T(std::move(value));
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    not_empty.notify();
+                    notify_selectors();
+                    return ChannelStatus::ok;
+                }
+            }
+            else if (diff < 0) {
+                return ChannelStatus::full;
+            }
+            else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Claims up to "wanted" free slots with one compare_exchange, and fills them from first,
+    // which is advanced past the values sent
+    template <typename ForwardIt>
+    ChannelStatus try_push_batch(ForwardIt &first, std::size_t wanted, std::size_t &sent) {
+        std::size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            if (pos & closed_bit) {
+                return ChannelStatus::closed;
+            }
+            std::size_t n {0};
+            while (n < wanted && n <= mask &&
+                   slots[(pos + n) & mask].sequence.load(std::memory_order_acquire) == pos + n) {
+                ++n;
+            }
+            if (n == 0) {
+                std::size_t sequence = slots[pos & mask].sequence.load(std::memory_order_acquire);
+                if (static_cast<std::intptr_t>(sequence - pos) < 0) {
+                    return ChannelStatus::full;
+                }
+                pos = tail.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (tail.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) {
+                for (std::size_t i{0}; i < n; ++i, ++first) {
+                    Slot &slot = slots[(pos + i) & mask];
+                    new (slot.storage) T(*first);
+                    slot.sequence.store(pos + i + 1, std::memory_order_release);
+                }
+                if (n == 1) {
+                    not_empty.notify();
+                }
+                else {
+                    not_empty.notify_all();
+                }
+                notify_selectors();
+                sent = n;
+                return ChannelStatus::ok;
+            }
+        }
+    }
+
+    template <typename OutputIt>
+    ChannelStatus try_pop_batch(OutputIt &out, std::size_t max, std::size_t &received) {
+        std::size_t pos = head.load(std::memory_order_relaxed);
+        while (true) {
+            std::size_t n {0};
+            while (n < max && n <= mask &&
+                   slots[(pos + n) & mask].sequence.load(std::memory_order_acquire) == pos + n + 1) {
+                ++n;
+            }
+            if (n == 0) {
+                std::size_t sequence = slots[pos & mask].sequence.load(std::memory_order_acquire);
+                if (static_cast<std::intptr_t>(sequence - (pos + 1)) < 0) {
+                    return is_drained(pos) ? ChannelStatus::closed : ChannelStatus::empty;
+                }
+                pos = head.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (head.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) {
+                for (std::size_t i{0}; i < n; ++i) {
+                    Slot &slot = slots[(pos + i) & mask];
+                    *out++ = std::move(*slot.get());
+                    slot.get()->~T();
+                    slot.sequence.store(pos + i + mask + 1, std::memory_order_release);
+                }
+                received = n;
+                if (n == 1) {
+                    not_full.notify();
+                }
+                else {
+                    not_full.notify_all();
+                }
+                notify_selectors();
+                return ChannelStatus::ok;
+            }
+        }
+    }
+
+    // Spin, then yield, then sleep on the EventCount; the caller tries again either way
+    // A receiver which is still spinning is not yet a waiter, so senders do not pay for a wake-up
+    template <typename Predicate>
+    void wait_while(EventCount &event, Predicate blocked) {
+        for (int i{0}; i < spin_limit; ++i) {
+            if (!blocked()) {
+                return;
+            }
+            if (i < spin_limit / 2) {
+                cpu_relax();
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+        auto key = event.prepare_wait();
+        if (!blocked()) {
+            event.cancel_wait();
+            return;
+        }
+        event.commit_wait(key);
+    }
+
+    // Closed, and every slot which was claimed before close() has been received
+    bool is_drained(std::size_t pos) const {
+        std::size_t t = tail.load(std::memory_order_acquire);
+        return (t & closed_bit) != 0 && pos >= (t & ~closed_bit);
+    }
+
+    // Estimates, used before going to sleep; a wrong answer only costs another try
+    bool full() const {
+        std::size_t t = tail.load(std::memory_order_acquire);
+        if (t & closed_bit) {
+            return false;
+        }
+        std::size_t sequence = slots[t & mask].sequence.load(std::memory_order_acquire);
+        return static_cast<std::intptr_t>(sequence - t) < 0;
+    }
+
+    bool empty() const {
+        std::size_t h = head.load(std::memory_order_acquire);
+        std::size_t sequence = slots[h & mask].sequence.load(std::memory_order_acquire);
+        return static_cast<std::intptr_t>(sequence - (h + 1)) < 0 && !is_drained(h);
+    }
+
+    const std::size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<std::size_t> head {0};
+    alignas(64) std::atomic<std::size_t> tail {0};
+    EventCount not_empty;
+    EventCount not_full;
+};
+
+/*
+ * Select
+ * - Waits until one of several channel operations can go ahead, then does that one only
+ *      - select.recv(channel, [](T value) { ... }) - a receive case
+ *      - select.send(channel, value, [] { ... }) - a send case
+ *      - wait() blocks until a case has run, and returns its index
+ *      - try_once() does not block; returns Select::none if no case was ready
+ *
+ * - A closed channel's case is skipped; when every case is closed, wait() returns Select::closed
+ *      - The element type of a receive case must be default constructible
+ *      - A send case moves its value into the channel, so T may be move-only
+ *      - It sends it once: after that, later waits skip it like a closed channel's case
+ *
+ * - Without polling: while it waits, the Select is registered with each of its channels
+ *      - Every send, receive or close on one of them notifies the Select's EventCount
+ *      - It then tries all the cases again, starting after the one which went last time, for fairness
+ *      */
+
+class Select {
+public:
+    static constexpr int none {-1};
+    static constexpr int closed {-2};
+
+    Select() = default;
+    Select(const Select &source) = delete;
+    Select &operator=(const Select &source) = delete;
+
+    template <typename T, typename Function>
+    Select &recv(Channel<T> &channel, Function on_value) {
+        cases.push_back(std::make_unique<RecvCase<T, Function>>(channel, std::move(on_value)));
+        return *this;
+    }
+
+    template <typename T, typename Function>
+    Select &send(Channel<T> &channel, T value, Function on_sent) {
+        cases.push_back(std::make_unique<SendCase<T, Function>>(channel, std::move(value), std::move(on_sent)));
+        return *this;
+    }
+
+    int try_once() { return attempt(); }
+
+    int wait() {
+        int result = attempt();
+        if (result != none) {
+            return result;
+        }
+        channel_detail::SelectWaiter waiter;
+        for (auto &c : cases) {
+            c->channel.add_selector(&waiter);
+        }
+        // Pairs with the fence before notify_selectors(): either the change is seen by attempt(), or we are notified
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (true) {
+            auto key = waiter.event.prepare_wait();
+            result = attempt();
+            if (result != none) {
+                waiter.event.cancel_wait();
+                break;
+            }
+            waiter.event.commit_wait(key);
+        }
+        for (auto &c : cases) {
+            c->channel.remove_selector(&waiter);
+        }
+        return result;
+    }
+
+private:
+    struct Case {
+        explicit Case(channel_detail::ChannelBase &channel) : channel(channel) {}
+        virtual ~Case() = default;
+        virtual ChannelStatus attempt() = 0;
+
+        channel_detail::ChannelBase &channel;
+    };
+
+    template <typename T, typename Function>
+    struct RecvCase : Case {
+        RecvCase(Channel<T> &channel, Function fn) : Case(channel), typed(channel), fn(std::move(fn)) {}
+
+        ChannelStatus attempt() override {
+            T value;
+            auto status = typed.try_recv(value);
+            if (status == ChannelStatus::ok) {
+                fn(std::move(value));
+            }
+            return status;
+        }
+
+        Channel<T> &typed;
+        Function fn;
+    };
+
+    template <typename T, typename Function>
+    struct SendCase : Case {
+        SendCase(Channel<T> &channel, T value, Function fn)
+            : Case(channel), typed(channel), value(std::move(value)), fn(std::move(fn)) {}
+
+        ChannelStatus attempt() override {
+            if (sent) {
+                return ChannelStatus::closed;
+            }
+            // Only moved from if it is sent
+            auto status = typed.try_send(std::move(value));
+            if (status == ChannelStatus::ok) {
+                sent = true;
+                fn();
+            }
+            return status;
+        }
+
+        Channel<T> &typed;
+        T value;
+        Function fn;
+        bool sent {false};
+    };
+
+    // One pass over the cases
+    int attempt() {
+        int n = static_cast<int>(cases.size());
+        bool any_open {false};
+        for (int i{0}; i < n; ++i) {
+            int index = (start + i) % n;
+            auto status = cases[index]->attempt();
+            if (status == ChannelStatus::ok) {
+                start = index + 1;
+                return index;
+            }
+            any_open = any_open || status != ChannelStatus::closed;
+        }
+        return any_open ? none : closed;
+    }
+
+    std::vector<std::unique_ptr<Case>> cases;
+    int start {0};
+};
+
+#endif //LOCK_GAURD_CHANNEL_H
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "channel.h"
+
+/*
+ * Channel benchmark
+ * - Throughput: producers send "messages" longs in total, consumers receive them all
+ *      - 1x1, 2x2, 4x4, 1x4 and 4x1 producers x consumers
+ *      - Channel: send()/recv() one at a time, and send_batch()/recv_batch() 32 at a time
+ *      - A bounded std::queue with a mutex and two condition variables, same capacity
+ *      - The consumers add up what they receive, which is checked
+ *
+ * - Latency: ping-pong between two threads over two channels of capacity 1
+ *      - Round trip time, p50 / p99 / max
+ *
+ * - Select: one consumer selects over 4 channels, each with its own producer
+ *
+ * Usage: channel_bench [messages] [capacity]
+ *      */
+
+using bench_clock = std::chrono::steady_clock;
+
+// What the std::queue version needs to be bounded and to close
+class LockedQueue {
+public:
+    explicit LockedQueue(std::size_t capacity) : capacity(capacity) {}
+
+    bool send(long value) {
+        std::unique_lock<std::mutex> uniq_lck(queue_mutex);
+        not_full.wait(uniq_lck, [this] { return items.size() < capacity || is_closed; });
+        if (is_closed) {
+            return false;
+        }
+        items.push(value);
+        uniq_lck.unlock();
+        not_empty.notify_one();
+        return true;
+    }
+
+    bool recv(long &out) {
+        std::unique_lock<std::mutex> uniq_lck(queue_mutex);
+        not_empty.wait(uniq_lck, [this] { return !items.empty() || is_closed; });
+        if (items.empty()) {
+            return false;
+        }
+        out = items.front();
+        items.pop();
+        uniq_lck.unlock();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lck_guard(queue_mutex);
+        is_closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+private:
+    const std::size_t capacity;
+    std::mutex queue_mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::queue<long> items;
+    bool is_closed {false};
+};
+
+constexpr std::size_t batch_size {32};
+
+// Sends [first, last) from each producer, then the last producer out closes the queue
+template <typename Queue, typename Send, typename Recv>
+void throughput(const std::string &name, Queue &queue, int producers, int consumers, long messages,
+                Send send, Recv recv) {
+    std::atomic<int> producers_left {producers};
+    std::atomic<long> total {0};
+    std::vector<std::thread> threads;
+    auto start = bench_clock::now();
+    for (int p{0}; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            send(queue, messages * p / producers, messages * (p + 1) / producers);
+            if (producers_left.fetch_sub(1) == 1) {
+                queue.close();
+            }
+        });
+    }
+    for (int c{0}; c < consumers; ++c) {
+        threads.emplace_back([&] { total.fetch_add(recv(queue)); });
+    }
+    for (auto &thr : threads) {
+        thr.join();
+    }
+    std::chrono::duration<double> elapsed = bench_clock::now() - start;
+    if (total.load() != messages * (messages - 1) / 2) {
+        std::cerr << name << ": wrong total" << std::endl;
+        std::exit(1);
+    }
+    std::cout << std::setw(14) << messages / elapsed.count() / 1e6;
+}
+
+void latency(long round_trips) {
+    Channel<long> ping(1), pong(1);
+    std::thread echo([&] {
+        long value {0};
+        while (ping.recv(value)) {
+            pong.send(value);
+        }
+    });
+    std::vector<long long> lat;
+    lat.reserve(round_trips);
+    for (long i{0}; i < round_trips; ++i) {
+        long value {0};
+        auto start = bench_clock::now();
+        ping.send(i);
+        pong.recv(value);
+        lat.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - start).count());
+    }
+    ping.close();
+    echo.join();
+    std::sort(lat.begin(), lat.end());
+    std::cout << "ping-pong round trip ns: p50 " << lat[lat.size() / 2] << "  p99 " << lat[lat.size() * 99 / 100]
+              << "  max " << lat.back() << std::endl;
+}
+
+void select_fan_in(long messages, std::size_t capacity) {
+    constexpr int nchannels {4};
+    std::vector<std::unique_ptr<Channel<long>>> channels;
+    for (int i{0}; i < nchannels; ++i) {
+        channels.push_back(std::make_unique<Channel<long>>(capacity));
+    }
+    std::vector<std::thread> producers;
+    auto start = bench_clock::now();
+    for (int i{0}; i < nchannels; ++i) {
+        producers.emplace_back([&, i] {
+            for (long m = messages * i / nchannels; m < messages * (i + 1) / nchannels; ++m) {
+                channels[i]->send(m);
+            }
+            channels[i]->close();
+        });
+    }
+    long total {0};
+    std::vector<long> per_channel(nchannels);
+    Select select;
+    for (int i{0}; i < nchannels; ++i) {
+        select.recv(*channels[i], [&, i](long value) {
+            total += value;
+            ++per_channel[i];
+        });
+    }
+    while (select.wait() != Select::closed) {
+    }
+    for (auto &thr : producers) {
+        thr.join();
+    }
+    std::chrono::duration<double> elapsed = bench_clock::now() - start;
+    if (total != messages * (messages - 1) / 2) {
+        std::cerr << "select: wrong total" << std::endl;
+        std::exit(1);
+    }
+    std::cout << "select over " << nchannels << " channels: " << messages / elapsed.count() / 1e6 << " M msg/s"
+              << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    long messages = argc > 1 ? std::atol(argv[1]) : 2000000L;
+    std::size_t capacity = argc > 2 ? std::atol(argv[2]) : 1024;
+
+    auto send_each = [](auto &queue, long first, long last) {
+        for (long m = first; m < last; ++m) {
+            queue.send(m);
+        }
+    };
+    auto recv_each = [](auto &queue) {
+        long sum {0}, value {0};
+        while (queue.recv(value)) {
+            sum += value;
+        }
+        return sum;
+    };
+    auto send_batches = [](Channel<long> &channel, long first, long last) {
+        long values[batch_size];
+        while (first < last) {
+            std::size_t n {0};
+            for (; n < batch_size && first < last; ++n) {
+                values[n] = first++;
+            }
+            channel.send_batch(values, values + n);
+        }
+    };
+    auto recv_batches = [](Channel<long> &channel) {
+        long sum {0};
+        long values[batch_size];
+        while (std::size_t n = channel.recv_batch(values, batch_size)) {
+            for (std::size_t i{0}; i < n; ++i) {
+                sum += values[i];
+            }
+        }
+        return sum;
+    };
+
+    std::cout << messages << " messages, capacity " << capacity << ", M msg/s" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::setw(6) << "PxC" << std::setw(14) << "Channel" << std::setw(14) << "batch 32"
+              << std::setw(14) << "std::queue" << std::endl;
+    const int configs[][2] {{1, 1}, {2, 2}, {4, 4}, {1, 4}, {4, 1}};
+    for (auto &config : configs) {
+        int producers = config[0], consumers = config[1];
+        std::cout << std::setw(4) << producers << "x" << consumers;
+        {
+            Channel<long> channel(capacity);
+            throughput("Channel", channel, producers, consumers, messages, send_each, recv_each);
+        }
+        {
+            Channel<long> channel(capacity);
+            throughput("batch", channel, producers, consumers, messages, send_batches, recv_batches);
+        }
+        {
+            LockedQueue queue(capacity);
+            throughput("std::queue", queue, producers, consumers, messages, send_each, recv_each);
+        }
+        std::cout << std::endl;
+    }
+
+    latency(std::min(messages, 100000L));
+    select_fan_in(messages, capacity);
+    return 0;
+}
@@ -0,0 +1,102 @@
+#ifndef LOCK_GAURD_EVENTCOUNT_H
+#define LOCK_GAURD_EVENTCOUNT_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "futex.h"
+
+/*
+ * EventCount
+ * - Task2() and Task3() poll the_mutex with try_lock_for(1s)
+ *      - Because there is no cheap way to "wait until something changed"
+ *
+ * - std::condition_variable needs a mutex
+ *      - The notifier must lock it, or a wakeup can be lost
+ *      - So it cannot be used with lock-free data structures
+ *
+ * - An eventcount is a condition variable without the mutex
+ *      - The waiter checks its condition (predicate) itself
+ *      - Lost wakeups are avoided with a two-step wait
+ *
+ * - Waiting
+ *      - key = prepare_wait()          announce "I am about to sleep"
+ *      - if the predicate is now true: cancel_wait()
+ *      - otherwise: commit_wait(key)  sleeps, unless notify() was called since prepare_wait()
+ *      - await(pred) does all of this in a loop
+ *
+ * - Notifying
+ *      - Make the change (e.g. push onto a lock-free queue), then call notify()
+ *      - If nobody is waiting, notify() is a fence and a load: no read-modify-write, no system call
+ *      - notify() wakes one sleeper, notify_all() wakes them all
+ *      */
+
+class EventCount {
+public:
+    class Key {
+    private:
+        friend class EventCount;
+        explicit Key(std::uint32_t epoch) : epoch(epoch) {}
+        std::uint32_t epoch;
+    };
+
+    EventCount() = default;
+    EventCount(const EventCount &source) = delete;
+    EventCount &operator=(const EventCount &source) = delete;
+
+    Key prepare_wait() {
+        // seq_cst pairs with the fence in notify(): either it sees us waiting, or we see its change
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        return Key(epoch.load(std::memory_order_seq_cst));
+    }
+
+    void cancel_wait() {
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void commit_wait(Key key) {
+        // Any notify() since prepare_wait() has changed the epoch
+        while (epoch.load(std::memory_order_acquire) == key.epoch) {
+            futex_wait(epoch, key.epoch);
+        }
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    template <typename Predicate>
+    void await(Predicate pred) {
+        while (!pred()) {
+            auto key = prepare_wait();
+            if (pred()) {
+                cancel_wait();
+                return;
+            }
+            commit_wait(key);
+        }
+    }
+
+    void notify() {
+        if (has_waiters()) {
+            epoch.fetch_add(1, std::memory_order_release);
+            futex_wake(epoch, 1);
+        }
+    }
+
+    void notify_all() {
+        if (has_waiters()) {
+            epoch.fetch_add(1, std::memory_order_release);
+            futex_wake_all(epoch);
+        }
+    }
+
+private:
+    bool has_waiters() {
+        // Orders the caller's change before the read of waiters
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return waiters.load(std::memory_order_relaxed) != 0;
+    }
+
+    alignas(64) std::atomic<std::uint32_t> epoch {0};
+    std::atomic<std::uint32_t> waiters {0};
+};
+
+#endif //LOCK_GAURD_EVENTCOUNT_H
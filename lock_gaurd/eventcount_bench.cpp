@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "eventcount.h"
+
+using namespace std::literals;
+
+/*
+ * EventCount benchmark
+ * - Notify cost when nobody is waiting
+ *      - EventCount::notify()
+ *      - std::condition_variable::notify_one() on its own
+ *      - lock, change, unlock, notify_one() - what a condition variable needs to be correct
+ *
+ * - Wake latency: from notify to the sleeping thread running again
+ *      - The waiter is given time to fall asleep before each notify
+ *
+ * - A blocking queue: a lock-free single-producer single-consumer ring
+ *      - The consumer blocks on an EventCount when the ring is empty
+ *      - The producer blocks on another when it is full
+ *
+ * Usage: eventcount_bench [wakeups] [queue items]
+ *      */
+
+using bench_clock = std::chrono::steady_clock;
+
+template <typename Notify>
+double notify_ns(int iterations, Notify notify) {
+    auto start = bench_clock::now();
+    for (int i{0}; i < iterations; ++i) {
+        notify();
+    }
+    std::chrono::duration<double, std::nano> elapsed = bench_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+struct Latencies {
+    long long p50;
+    long long p99;
+    long long max;
+};
+
+Latencies summarise(std::vector<long long> &lat) {
+    std::sort(lat.begin(), lat.end());
+    return {lat[lat.size() / 2], lat[lat.size() * 99 / 100], lat.back()};
+}
+
+// The notifier stores the time, then bumps "sequence" and notifies
+struct WakeShared {
+    std::atomic<std::uint32_t> sequence {0};
+    std::atomic<bench_clock::rep> notified_at {0};
+};
+
+long long since(const WakeShared &shared) {
+    auto now = bench_clock::now().time_since_epoch().count();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        bench_clock::duration(now - shared.notified_at.load(std::memory_order_acquire))).count();
+}
+
+Latencies eventcount_wake(int wakeups) {
+    WakeShared shared;
+    EventCount ec;
+    std::vector<long long> lat;
+    lat.reserve(wakeups);
+
+    std::thread waiter([&] {
+        for (std::uint32_t i{1}; i <= static_cast<std::uint32_t>(wakeups); ++i) {
+            ec.await([&] { return shared.sequence.load(std::memory_order_acquire) >= i; });
+            lat.push_back(since(shared));
+        }
+    });
+    for (int i{0}; i < wakeups; ++i) {
+        std::this_thread::sleep_for(50us);
+        shared.notified_at.store(bench_clock::now().time_since_epoch().count(), std::memory_order_release);
+        shared.sequence.fetch_add(1, std::memory_order_release);
+        ec.notify();
+    }
+    waiter.join();
+    return summarise(lat);
+}
+
+Latencies condvar_wake(int wakeups) {
+    WakeShared shared;
+    std::mutex mut;
+    std::condition_variable cv;
+    std::vector<long long> lat;
+    lat.reserve(wakeups);
+
+    std::thread waiter([&] {
+        for (std::uint32_t i{1}; i <= static_cast<std::uint32_t>(wakeups); ++i) {
+            std::unique_lock<std::mutex> uniq_lck(mut);
+            cv.wait(uniq_lck, [&] { return shared.sequence.load(std::memory_order_relaxed) >= i; });
+            uniq_lck.unlock();
+            lat.push_back(since(shared));
+        }
+    });
+    for (int i{0}; i < wakeups; ++i) {
+        std::this_thread::sleep_for(50us);
+        shared.notified_at.store(bench_clock::now().time_since_epoch().count(), std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lck_guard(mut);
+            shared.sequence.fetch_add(1, std::memory_order_relaxed);
+        }
+        cv.notify_one();
+    }
+    waiter.join();
+    return summarise(lat);
+}
+
+/*
+ * Blocking SPSC queue
+ * - head and tail are only written by one thread each, no locks
+ * - Blocking only happens when the ring is empty (consumer) or full (producer)
+ * - While the ring is neither, notify() is just a fence and a load
+ *      */
+
+template <typename T, std::size_t Capacity>
+class BlockingSpscQueue {
+public:
+    void push(T value) {
+        auto tail_now = tail.load(std::memory_order_relaxed);
+        not_full.await([&] { return tail_now - head.load(std::memory_order_acquire) < Capacity; });
+        ring[tail_now % Capacity] = value;
+        tail.store(tail_now + 1, std::memory_order_release);
+        not_empty.notify();
+    }
+
+    T pop() {
+        auto head_now = head.load(std::memory_order_relaxed);
+        not_empty.await([&] { return tail.load(std::memory_order_acquire) != head_now; });
+        T value = ring[head_now % Capacity];
+        head.store(head_now + 1, std::memory_order_release);
+        not_full.notify();
+        return value;
+    }
+
+private:
+    std::array<T, Capacity> ring;
+    alignas(64) std::atomic<std::size_t> head {0};
+    alignas(64) std::atomic<std::size_t> tail {0};
+    EventCount not_empty;
+    EventCount not_full;
+};
+
+void queue_transfer(long long items) {
+    static BlockingSpscQueue<long long, 1024> queue;
+    long long sum {0};
+
+    auto start = bench_clock::now();
+    std::thread consumer([&] {
+        for (long long i{0}; i < items; ++i) {
+            sum += queue.pop();
+        }
+    });
+    for (long long i{0}; i < items; ++i) {
+        queue.push(i);
+    }
+    consumer.join();
+    std::chrono::duration<double> elapsed = bench_clock::now() - start;
+
+    std::cout << "BlockingSpscQueue: " << items << " items, " << items / elapsed.count() / 1e6 << " M items/s";
+    if (sum != items * (items - 1) / 2) {
+        std::cout << " - WRONG SUM " << sum;
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int wakeups = argc > 1 ? std::atoi(argv[1]) : 2000;
+    long long items = argc > 2 ? std::atoll(argv[2]) : 10000000;
+    const int iterations {10000000};
+
+    EventCount ec;
+    std::mutex mut;
+    std::condition_variable cv;
+    std::atomic<int> value {0};
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "notify with no waiters (ns)" << std::endl;
+    std::cout << "  EventCount::notify()         "
+              << notify_ns(iterations, [&] { ec.notify(); }) << std::endl;
+    std::cout << "  condition_variable notify    "
+              << notify_ns(iterations, [&] { cv.notify_one(); }) << std::endl;
+    std::cout << "  store + EventCount::notify() "
+              << notify_ns(iterations, [&] {
+                     value.store(1, std::memory_order_release);
+                     ec.notify();
+                 }) << std::endl;
+    std::cout << "  lock, store, unlock, notify  "
+              << notify_ns(iterations, [&] {
+                     {
+                         std::lock_guard<std::mutex> lck_guard(mut);
+                         value.store(1, std::memory_order_relaxed);
+                     }
+                     cv.notify_one();
+                 }) << std::endl;
+
+    std::cout << "wake latency (ns, " << wakeups << " wakeups)" << std::endl;
+    auto print = [](const char *name, Latencies lat) {
+        std::cout << "  " << std::setw(28) << std::left << name << std::right << "p50 " << lat.p50
+                  << ", p99 " << lat.p99 << ", max " << lat.max << std::endl;
+    };
+    print("EventCount", eventcount_wake(wakeups));
+    print("condition_variable", condvar_wake(wakeups));
+
+    queue_transfer(items);
+    return 0;
+}
@@ -0,0 +1,83 @@
+#ifndef LOCK_GAURD_EXECUTOR_H
+#define LOCK_GAURD_EXECUTOR_H
+
+#include <coroutine>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Executor
+ * - Somewhere to resume a suspended coroutine
+ *      - The async primitives do not resume waiters on the unlocking thread
+ *      - They post the coroutine handle to an executor instead
+ *      - The unlocking coroutine carries on without running the waiter's code
+ *
+ * - ThreadPoolExecutor
+ *      - A fixed number of worker threads and one shared queue of handles
+ *      - Thousands of coroutines can be multiplexed onto a handful of threads
+ *      */
+
+class Executor {
+public:
+    virtual ~Executor() = default;
+    // Arrange for the coroutine to be resumed on one of the executor's threads
+    virtual void post(std::coroutine_handle<> handle) = 0;
+};
+
+class ThreadPoolExecutor : public Executor {
+public:
+    explicit ThreadPoolExecutor(unsigned nthreads) {
+        for (unsigned i{0}; i < nthreads; ++i) {
+            workers.emplace_back([this] { run(); });
+        }
+    }
+
+    ThreadPoolExecutor(const ThreadPoolExecutor &source) = delete;
+    ThreadPoolExecutor &operator=(const ThreadPoolExecutor &source) = delete;
+
+    ~ThreadPoolExecutor() override {
+        {
+            std::lock_guard<std::mutex> lck_guard(queue_mutex);
+            stopping = true;
+        }
+        queue_cv.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    void post(std::coroutine_handle<> handle) override {
+        {
+            std::lock_guard<std::mutex> lck_guard(queue_mutex);
+            queue.push_back(handle);
+        }
+        queue_cv.notify_one();
+    }
+
+private:
+    void run() {
+        while (true) {
+            std::unique_lock<std::mutex> uniq_lck(queue_mutex);
+            queue_cv.wait(uniq_lck, [this] { return stopping || !queue.empty(); });
+            // Drain the queue before stopping, so no coroutine is left suspended
+            if (queue.empty()) {
+                return;
+            }
+            auto handle = queue.front();
+            queue.pop_front();
+            uniq_lck.unlock();
+            handle.resume();
+        }
+    }
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<std::coroutine_handle<>> queue;
+    bool stopping {false};
+    std::vector<std::thread> workers;
+};
+
+#endif //LOCK_GAURD_EXECUTOR_H
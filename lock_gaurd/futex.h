@@ -0,0 +1,111 @@
+#ifndef LOCK_GAURD_FUTEX_H
+#define LOCK_GAURD_FUTEX_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+/*
+ * Futex ("fast userspace mutex")
+ * - Lets a thread sleep until a 32-bit word changes
+ *      - futex_wait(word, expected): sleep, but only if word still equals expected
+ *      - futex_wake(word, n): wake up to n threads sleeping on word
+ *      - The check and the sleep are atomic, so a wakeup cannot be lost
+ *
+ * - The uncontended path never enters the kernel
+ *      - A lock only calls futex_wake() if somebody might be asleep
+ *
+ * - futex_wait() may return early ("spurious wakeup")
+ *      - Callers always re-check the word in a loop
+ *
+ * - Linux has the futex system call
+ *      - Elsewhere, a small table of mutexes and condition variables stands in for it
+ *      - The word's address picks the table entry
+ *      */
+
+#if defined(__linux__)
+
+inline void futex_wait(std::atomic<std::uint32_t> &word, std::uint32_t expected) {
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+// Returns false if the deadline passed
+inline bool futex_wait_until(std::atomic<std::uint32_t> &word, std::uint32_t expected,
+                             std::chrono::steady_clock::time_point deadline) {
+    // steady_clock is CLOCK_MONOTONIC, which FUTEX_WAIT_BITSET uses for an absolute timeout
+    auto since_epoch = deadline.time_since_epoch();
+    auto secs = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+    timespec timeout {};
+    timeout.tv_sec = secs.count();
+    timeout.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch - secs).count();
+    if (syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT_BITSET_PRIVATE, expected,
+                &timeout, nullptr, FUTEX_BITSET_MATCH_ANY) == 0) {
+        return true;
+    }
+    return std::chrono::steady_clock::now() < deadline;
+}
+
+inline void futex_wake(std::atomic<std::uint32_t> &word, int count) {
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+inline void futex_wake_all(std::atomic<std::uint32_t> &word) {
+    futex_wake(word, INT_MAX);
+}
+
+#else
+
+struct FutexBucket {
+    std::mutex mut;
+    std::condition_variable cv;
+};
+
+inline FutexBucket &futex_bucket(const void *address) {
+    static FutexBucket buckets[64];
+    auto hash = reinterpret_cast<std::uintptr_t>(address) >> 4;
+    return buckets[hash % 64];
+}
+
+inline void futex_wait(std::atomic<std::uint32_t> &word, std::uint32_t expected) {
+    auto &bucket = futex_bucket(&word);
+    std::unique_lock<std::mutex> uniq_lck(bucket.mut);
+    if (word.load(std::memory_order_relaxed) == expected) {
+        bucket.cv.wait(uniq_lck);
+    }
+}
+
+inline bool futex_wait_until(std::atomic<std::uint32_t> &word, std::uint32_t expected,
+                             std::chrono::steady_clock::time_point deadline) {
+    auto &bucket = futex_bucket(&word);
+    std::unique_lock<std::mutex> uniq_lck(bucket.mut);
+    if (word.load(std::memory_order_relaxed) == expected) {
+        return bucket.cv.wait_until(uniq_lck, deadline) == std::cv_status::no_timeout;
+    }
+    return true;
+}
+
+inline void futex_wake(std::atomic<std::uint32_t> &word, int) {
+    // Several words can share a bucket, so everybody in it has to re-check
+    auto &bucket = futex_bucket(&word);
+    std::lock_guard<std::mutex> lck_guard(bucket.mut);
+    bucket.cv.notify_all();
+}
+
+inline void futex_wake_all(std::atomic<std::uint32_t> &word) {
+    futex_wake(word, 0);
+}
+
+#endif
+
+#endif //LOCK_GAURD_FUTEX_H
@@ -0,0 +1,453 @@
+#ifndef LOCK_GAURD_LOCK_WATCHDOG_H
+#define LOCK_GAURD_LOCK_WATCHDOG_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <execinfo.h>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+/*
+ * Lock hold-time watchdog
+ * - task1() holds the_mutex for 5 seconds
+ *      - Every other thread which needs the mutex is stuck for that time
+ *      - Nothing in the program tells us this is happening
+ *
+ * - WatchedMutex<Mutex> wraps a mutex and records who holds it, and since when
+ *      - It has the same member functions as the wrapped mutex
+ *      - It works with std::lock_guard, std::unique_lock and std::scoped_lock
+ *
+ * - LockWatchdog is a background thread which checks the watched mutexes
+ *      - Opt-in: nothing is recorded until start() is called
+ *      - If a mutex has been held for longer than the threshold
+ *      - It captures the holder's thread id and a backtrace of the holder's stack
+ *      - It reports through a callback, by default a structured log line on std::cerr
+ *
+ * - Cost
+ *      - Locking: a clock read and a few relaxed stores
+ *      - Watchdog: a few atomic loads per watched mutex, every poll period
+ *      - The expensive part (signal, backtrace, symbols) only runs when a hold is over the threshold
+ *      */
+
+/*
+ * Capturing another thread's stack
+ * - backtrace() only works on the calling thread
+ * - The watchdog sends a signal to the holding thread
+ *      - The signal handler calls backtrace() into a preallocated buffer
+ *      - The watchdog waits for the handler, then resolves the symbols itself
+ * - The default signal is SIGURG, which is ignored by default and rarely used
+ * - Link with ENABLE_EXPORTS (-rdynamic) to get function names instead of addresses
+ * */
+
+struct HoldReport {
+    std::string lock_name;
+    std::thread::id holder;
+    long holder_tid;                        // kernel thread id on Linux, otherwise 0
+    std::chrono::milliseconds held_for;
+    std::chrono::milliseconds threshold;
+    std::vector<std::string> backtrace;     // innermost frame first
+};
+
+// Default callback: one key=value line per report, then one line per frame
+inline void log_hold_report(const HoldReport &report) {
+    std::cerr << "lock_watchdog: event=long_hold lock=" << report.lock_name
+              << " thread=" << report.holder
+              << " tid=" << report.holder_tid
+              << " held_ms=" << report.held_for.count()
+              << " threshold_ms=" << report.threshold.count()
+              << " frames=" << report.backtrace.size() << std::endl;
+    for (std::size_t i{0}; i < report.backtrace.size(); ++i) {
+        std::cerr << "lock_watchdog:   #" << i << " " << report.backtrace[i] << std::endl;
+    }
+}
+
+struct WatchdogOptions {
+    std::chrono::milliseconds threshold {1000};
+    std::chrono::milliseconds poll_period {100};
+    int capture_signal {SIGURG};
+    std::function<void(const HoldReport &)> on_long_hold {log_hold_report};
+};
+
+class LockWatchdog;
+
+// Hold tracking shared by all WatchedMutex types
+class WatchedLockBase {
+public:
+    explicit inline WatchedLockBase(std::string name);
+    inline ~WatchedLockBase();
+
+    WatchedLockBase(const WatchedLockBase &source) = delete;
+    WatchedLockBase &operator=(const WatchedLockBase &source) = delete;
+
+    const std::string &name() const { return lock_name; }
+
+protected:
+    inline void note_acquired() noexcept;
+    inline void note_released() noexcept;
+
+private:
+    friend class LockWatchdog;
+
+    std::string lock_name;
+    // 0 when not held (or when the watchdog is not running)
+    std::atomic<std::int64_t> held_since_ns {0};
+    // Incremented on every tracked acquisition, so each hold is reported once
+    std::atomic<std::uint64_t> hold_count {0};
+    std::atomic<pthread_t> holder_handle {};
+    std::atomic<std::thread::id> holder_id {};
+    std::atomic<long> holder_tid {0};
+    std::uint64_t reported_hold {0};        // only accessed by the watchdog thread
+};
+
+class LockWatchdog {
+public:
+    static LockWatchdog &instance() {
+        static LockWatchdog watchdog;
+        return watchdog;
+    }
+
+    LockWatchdog(const LockWatchdog &source) = delete;
+    LockWatchdog &operator=(const LockWatchdog &source) = delete;
+
+    ~LockWatchdog() { stop(); }
+
+    void start(WatchdogOptions opts = {}) {
+        std::lock_guard<std::mutex> lck_guard(control_mutex);
+        if (running) {
+            return;
+        }
+        options = std::move(opts);
+
+        // The first call to backtrace() may load libgcc, which is not safe in a signal handler
+        void *warm_up[1];
+        ::backtrace(warm_up, 1);
+
+        struct sigaction action {};
+        action.sa_handler = on_capture_signal;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(options.capture_signal, &action, &previous_action);
+
+        stopping = false;
+        running = true;
+        enabled().store(true, std::memory_order_relaxed);
+        watcher = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        std::lock_guard<std::mutex> lck_guard(control_mutex);
+        if (!running) {
+            return;
+        }
+        enabled().store(false, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lck(wake_mutex);
+            stopping = true;
+        }
+        wake_cv.notify_one();
+        watcher.join();
+        sigaction(options.capture_signal, &previous_action, nullptr);
+        running = false;
+    }
+
+    // Checked on the lock path, so an idle program pays for one relaxed load
+    static std::atomic<bool> &enabled() {
+        static std::atomic<bool> flag {false};
+        return flag;
+    }
+
+private:
+    friend class WatchedLockBase;
+
+    static constexpr int max_frames {64};
+
+    LockWatchdog() = default;
+
+    void add(WatchedLockBase *lock) {
+        std::lock_guard<std::mutex> lck_guard(registry_mutex);
+        locks.push_back(lock);
+    }
+
+    void remove(WatchedLockBase *lock) {
+        std::lock_guard<std::mutex> lck_guard(registry_mutex);
+        locks.erase(std::remove(locks.begin(), locks.end(), lock), locks.end());
+    }
+
+    static std::int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> uniq_lck(wake_mutex);
+        while (!wake_cv.wait_for(uniq_lck, options.poll_period, [this] { return stopping; })) {
+            uniq_lck.unlock();
+            scan();
+            uniq_lck.lock();
+        }
+    }
+
+    // A hold over the threshold, copied out of its WatchedLockBase under registry_mutex
+    struct LongHold {
+        WatchedLockBase *lock;
+        std::string lock_name;
+        pthread_t handle;
+        std::thread::id holder;
+        long tid;
+        std::int64_t since;
+        std::uint64_t hold;
+    };
+
+    void scan() {
+        std::vector<LongHold> long_holds;
+        {
+            std::lock_guard<std::mutex> lck_guard(registry_mutex);
+            auto threshold_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(options.threshold).count();
+            for (auto *lock : locks) {
+                auto since = lock->held_since_ns.load(std::memory_order_acquire);
+                if (since == 0 || now_ns() - since < threshold_ns) {
+                    continue;
+                }
+                auto hold = lock->hold_count.load(std::memory_order_acquire);
+                if (hold == lock->reported_hold) {
+                    continue;
+                }
+                lock->reported_hold = hold;
+                long_holds.push_back({lock, lock->lock_name, lock->holder_handle.load(std::memory_order_relaxed),
+                                      lock->holder_id.load(std::memory_order_relaxed),
+                                      lock->holder_tid.load(std::memory_order_relaxed), since, hold});
+            }
+        }
+        // Every WatchedMutex constructor and destructor takes registry_mutex, so the capture (up to 100 ms)
+        // and the callback run without it
+        for (const auto &long_hold : long_holds) {
+            report(long_hold);
+        }
+    }
+
+    void report(const LongHold &long_hold) {
+        int nframes = capture(long_hold.handle, long_hold.tid);
+
+        {
+            // The lock may have been destroyed, or released and perhaps re-acquired, during the capture
+            std::lock_guard<std::mutex> lck_guard(registry_mutex);
+            if (std::find(locks.begin(), locks.end(), long_hold.lock) == locks.end() ||
+                long_hold.lock->hold_count.load(std::memory_order_acquire) != long_hold.hold) {
+                return;
+            }
+        }
+
+        HoldReport hold_report;
+        hold_report.lock_name = long_hold.lock_name;
+        hold_report.holder = long_hold.holder;
+        hold_report.holder_tid = long_hold.tid;
+        hold_report.threshold = options.threshold;
+        hold_report.held_for = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::nanoseconds(now_ns() - long_hold.since));
+
+        if (nframes > 0) {
+            char **symbols = ::backtrace_symbols(captured_frames(), nframes);
+            // Skip the signal handler's own frame
+            for (int i{1}; i < nframes; ++i) {
+                hold_report.backtrace.push_back(symbols != nullptr ? symbols[i] : "?");
+            }
+            std::free(symbols);
+        }
+        if (options.on_long_hold) {
+            options.on_long_hold(hold_report);
+        }
+    }
+
+    /*
+     * Make the holding thread record its own stack, and wait for it
+     * - Each capture has a sequence number, so a signal which arrives after its capture timed out
+     *   cannot hand its frames to a later one
+     *      - The handler only runs for the thread it was sent to, and claims the request by swapping
+     *        its number for 0; a request can be claimed once
+     *      - A timed out capture takes its request back the same way, or, if a handler got it first,
+     *        waits for that handler to finish writing the frames
+     *      */
+    int capture(pthread_t handle, long tid) {
+        std::uint64_t sequence = ++capture_sequence;
+        capture_handle().store(handle, std::memory_order_relaxed);
+        capture_tid().store(tid, std::memory_order_relaxed);
+        capture_request().store(sequence, std::memory_order_release);
+#if defined(__linux__)
+        // tgkill() fails cleanly if the thread has already exited
+        bool sent = syscall(SYS_tgkill, getpid(), tid, options.capture_signal) == 0;
+#else
+        bool sent = pthread_kill(handle, options.capture_signal) == 0;
+#endif
+        for (int i{0}; sent && i < 100; ++i) {
+            if (captured_sequence().load(std::memory_order_acquire) == sequence) {
+                return captured_count().load(std::memory_order_relaxed);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (capture_request().compare_exchange_strong(sequence, 0, std::memory_order_acq_rel)) {
+            return 0;
+        }
+        // A handler has claimed this request and is writing the frames
+        while (captured_sequence().load(std::memory_order_acquire) != sequence) {
+            std::this_thread::yield();
+        }
+        return captured_count().load(std::memory_order_relaxed);
+    }
+
+    static void **captured_frames() {
+        static void *frames[max_frames];
+        return frames;
+    }
+
+    // The request being captured, 0 when there is none
+    static std::atomic<std::uint64_t> &capture_request() {
+        static std::atomic<std::uint64_t> sequence {0};
+        return sequence;
+    }
+
+    static std::atomic<pthread_t> &capture_handle() {
+        static std::atomic<pthread_t> handle {};
+        return handle;
+    }
+
+    static std::atomic<long> &capture_tid() {
+        static std::atomic<long> tid {0};
+        return tid;
+    }
+
+    // The request which captured_frames() and captured_count() belong to
+    static std::atomic<std::uint64_t> &captured_sequence() {
+        static std::atomic<std::uint64_t> sequence {0};
+        return sequence;
+    }
+
+    static std::atomic<int> &captured_count() {
+        static std::atomic<int> count {0};
+        return count;
+    }
+
+    static void on_capture_signal(int) {
+        std::uint64_t sequence = capture_request().load(std::memory_order_acquire);
+        if (sequence == 0) {
+            return;
+        }
+        int saved_errno = errno;
+#if defined(__linux__)
+        bool target = syscall(SYS_gettid) == capture_tid().load(std::memory_order_relaxed);
+#else
+        bool target = pthread_equal(pthread_self(), capture_handle().load(std::memory_order_relaxed)) != 0;
+#endif
+        if (target && capture_request().compare_exchange_strong(sequence, 0, std::memory_order_acq_rel)) {
+            captured_count().store(::backtrace(captured_frames(), max_frames), std::memory_order_relaxed);
+            captured_sequence().store(sequence, std::memory_order_release);
+        }
+        errno = saved_errno;
+    }
+
+    std::mutex control_mutex;
+    bool running {false};
+    WatchdogOptions options;
+    struct sigaction previous_action {};
+    std::thread watcher;
+    std::uint64_t capture_sequence {0};     // only accessed by the watchdog thread
+
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+    bool stopping {false};
+
+    std::mutex registry_mutex;
+    std::vector<WatchedLockBase *> locks;
+};
+
+WatchedLockBase::WatchedLockBase(std::string name) : lock_name(std::move(name)) {
+    LockWatchdog::instance().add(this);
+}
+
+WatchedLockBase::~WatchedLockBase() {
+    LockWatchdog::instance().remove(this);
+}
+
+void WatchedLockBase::note_acquired() noexcept {
+    if (!LockWatchdog::enabled().load(std::memory_order_relaxed)) {
+        return;
+    }
+#if defined(__linux__)
+    thread_local long tid = syscall(SYS_gettid);
+#else
+    long tid {0};
+#endif
+    holder_handle.store(pthread_self(), std::memory_order_relaxed);
+    holder_id.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    holder_tid.store(tid, std::memory_order_relaxed);
+    hold_count.fetch_add(1, std::memory_order_relaxed);
+    held_since_ns.store(LockWatchdog::now_ns(), std::memory_order_release);
+}
+
+void WatchedLockBase::note_released() noexcept {
+    held_since_ns.store(0, std::memory_order_relaxed);
+}
+
+// Drop-in replacement for a mutex, e.g. WatchedMutex<std::timed_mutex> the_mutex("the_mutex");
+template <typename Mutex>
+class WatchedMutex : public WatchedLockBase {
+public:
+    explicit WatchedMutex(std::string name) : WatchedLockBase(std::move(name)) {}
+
+    void lock() {
+        mut.lock();
+        note_acquired();
+    }
+
+    bool try_lock() {
+        if (!mut.try_lock()) {
+            return false;
+        }
+        note_acquired();
+        return true;
+    }
+
+    // Only compiled if Mutex is a timed mutex
+    template <typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period> &timeout) {
+        if (!mut.try_lock_for(timeout)) {
+            return false;
+        }
+        note_acquired();
+        return true;
+    }
+
+    template <typename Clock, typename Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration> &deadline) {
+        if (!mut.try_lock_until(deadline)) {
+            return false;
+        }
+        note_acquired();
+        return true;
+    }
+
+    void unlock() {
+        note_released();
+        mut.unlock();
+    }
+
+private:
+    Mutex mut;
+};
+
+#endif //LOCK_GAURD_LOCK_WATCHDOG_H
@@ -0,0 +1,54 @@
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "lock_watchdog.h"
+
+using namespace std::literals;
+
+/*
+ * Lock watchdog demo
+ * - The same scenario as task1() and Task3() in main.cpp
+ *      - task1() holds the mutex for 5 seconds
+ *      - Task3() polls it with try_lock_for(1s)
+ * - the_mutex is now a WatchedMutex<std::timed_mutex>
+ *      - Nothing else in the tasks changes
+ * - The watchdog reports the long hold after 1 second
+ *      - With the holder's thread id and a backtrace which ends in task1()
+ *      */
+
+WatchedMutex<std::timed_mutex> the_mutex("the_mutex");
+
+void task1() {
+    std::cout << "Task1 trying to lock the mutex" << std::endl;
+    std::lock_guard<WatchedMutex<std::timed_mutex>> lck_guard(the_mutex);
+    std::cout << "Task1 locks the mutex" << std::endl;
+    std::this_thread::sleep_for(5s);
+    std::cout << "Task1 unlocking the mutex" << std::endl;
+}
+
+void Task3() {
+    std::this_thread::sleep_for(500ms);
+    std::cout << "Task2 trying to lock the mutex" << std::endl;
+    std::unique_lock<WatchedMutex<std::timed_mutex>> uniq_lck(the_mutex, std::defer_lock);
+
+    while (!uniq_lck.try_lock_for(1s)) {
+        std::cout << "Task2 could not lock the mutex" << std::endl;
+    }
+    std::cout << "Task2 has locked the mutex" << std::endl;
+}
+
+int main() {
+    WatchdogOptions options;
+    options.threshold = 1s;
+    options.poll_period = 100ms;
+    LockWatchdog::instance().start(options);
+
+    std::thread v1(task1);
+    std::thread v2(Task3);
+    v1.join(), v2.join();
+
+    LockWatchdog::instance().stop();
+    return 0;
+}
@@ -4,6 +4,9 @@
 #include <chrono>
 #include <string>
 
+#include "backoff.h"
+#include "semaphore.h"
+
 using namespace std::literals;
 
 
@@ -236,8 +239,118 @@ using namespace std::literals;
  *      - Due to scheduling issues
  *      */
 
+/*
+ * Coroutine mutex (async_mutex.h)
+ * - task1() holds the_mutex for 5 seconds
+ *      - Every thread which waits for it is blocked for 5 seconds
+ *      - Each waiter costs a whole OS thread
+ *
+ * - AsyncMutex is locked with co_await (C++20)
+ *      - The waiting coroutine is suspended, the thread is not
+ *      - unlock() hands the mutex to the next waiter and resumes it on an executor
+ *      - See async_mutex_bench.cpp
+ *      */
+
+/*
+ * Lock hold-time watchdog (lock_watchdog.h)
+ * - A long hold like task1()'s is invisible until something else goes slow
+ * - WatchedMutex<std::timed_mutex> the_mutex("the_mutex");
+ *      - Only the type of the mutex changes
+ * - LockWatchdog::instance().start() reports any hold longer than the threshold
+ *      - Holder's thread id and backtrace
+ *      - See lock_watchdog_demo.cpp
+ *      */
+
+/*
+ * Queue locks (mcs_lock.h, ticket_lock.h)
+ * - When many threads contend for print_mutex, they all wait on the same word
+ * - TicketLock: FIFO, but all waiters still watch one counter
+ *      - Waiters back off in proportion to their place in the queue
+ *      - Fair: every thread in task() gets the lock about as often as the others
+ *      - See ticket_lock_bench.cpp
+ * - McsLock: FIFO, and each waiter spins on its own node
+ *      - unlock() only touches the next waiter's cache line
+ * - Both work with std::lock_guard and std::unique_lock
+ *      std::unique_lock<McsLock> uniq_lck(print_mutex);
+ * - See mcs_lock_bench.cpp
+ *      */
+
+/*
+ * Policy-based locks (basic_lock.h)
+ * - std::mutex, std::timed_mutex, spin locks... are all separate classes
+ * - BasicLock<WaitPolicy, StatsPolicy> is one template
+ *      - Wait policy: spin, spin-yield, futex park, or hybrid
+ *      - Stats policy: none, counters, or a histogram of wait times
+ *      - Unused policies cost nothing: BasicLock<SpinPolicy, NoStats> is 4 bytes
+ * - It has the std::timed_mutex interface, so only the type changes
+ *      BasicLock<HybridPolicy, NoStats> print_mutex;
+ *      BasicLock<FutexParkPolicy, CounterStats> the_mutex;
+ * - See basic_lock_bench.cpp
+ *      */
+
+/*
+ * Counting semaphore (semaphore.h)
+ * - A mutex lets one thread into the critical section
+ * - A semaphore with n permits lets up to n threads in
+ *      - acquire() takes a permit, release() gives it back
+ *      - SemaphorePermit does this with RAII, like std::lock_guard
+ * - task() uses one to limit how many threads are printing at the same time
+ *      - The other threads wait until a printer finishes
+ *      - print_mutex still protects each line
+ * - See semaphore_bench.cpp
+ *      */
+
+/*
+ * Latch and Barrier (barrier.h)
+ * - The demos start threads, join() them all, then start new ones for the next phase
+ * - Latch: one-shot countdown, wait() returns when it reaches zero
+ * - Barrier: reusable, arrive_and_wait() returns when every thread has arrived
+ *      - The same threads go through phase after phase
+ *      - Optional completion function, run once per phase
+ * - TreeBarrier spreads the arrivals over a tree, for large thread counts
+ * - See barrier_bench.cpp
+ *      */
+
+/*
+ * EventCount (eventcount.h)
+ * - Task2() and Task3() poll with try_lock_for(1s) because there is nothing to "wait until something changed"
+ * - An eventcount is a condition variable without a mutex
+ *      - prepare_wait(), re-check the condition, then commit_wait() or cancel_wait()
+ *      - await(pred) wraps that loop
+ *      - notify() costs a fence and a load when nobody waits
+ * - Works with lock-free data, e.g. a blocking lock-free queue
+ * - See eventcount_bench.cpp
+ *      */
+
+/*
+ * Backoff (backoff.h)
+ * - Task3() retries try_lock_for(1s) with a fixed period
+ * - acquire_with_backoff(the_mutex, policy) calls try_lock(), and sleeps between attempts
+ *      - ExponentialBackoff, DecorrelatedJitterBackoff, Capped<Policy>
+ *      - Optional deadline for the whole wait
+ *      - Returns the number of attempts and the time spent waiting
+ * - See Task4() and backoff_bench.cpp
+ *      */
+
+/*
+ * Channel (channel.h)
+ * - The threads here share variables, and protect them with mutexes
+ * - A Channel<T> passes values between threads instead, like a Go channel
+ *      - Bounded: send() waits while it is full, recv() waits while it is empty
+ *      - try_send() and try_recv() do not wait, send_batch() and recv_batch() move many values at once
+ *      - close(): receivers get what was already sent, then recv() returns false
+ * - Lock-free ring of slots with sequence numbers; waiting threads sleep on an EventCount
+ * - Select waits on several channels at once, without polling
+ * - See channel_bench.cpp
+ *      */
+
 std::mutex print_mutex;
+
+// At most two threads run the printing loop at once
+CountingSemaphore printers(2);
+
 void task(std::string str) {
+    SemaphorePermit permit(printers);
     for (int i{0}; i < 5; ++i) {
         // Create an std::unique_lock object
         // This calls print_mutex.lock()
@@ -326,6 +439,20 @@ void Task3() {
     std::cout << "Task2 has locked the mutex" << std::endl;
     // End of critical section
 }
+
+void Task4() {
+    std::this_thread::sleep_for(500ms);
+    std::cout << "Task4 trying to lock the mutex" << std::endl;
+
+    // Wait 10ms, 20ms, 40ms... between attempts, at most 1 second
+    auto result = acquire_with_backoff(the_mutex, Capped<ExponentialBackoff>(ExponentialBackoff(10ms), 1s));
+    std::unique_lock<std::timed_mutex> uniq_lck(the_mutex, std::adopt_lock);
+
+    //start of critical section
+    std::cout << "Task4 has locked the mutex after " << result.attempts << " attempts" << std::endl;
+    // End of critical section
+}
+
 int main() {
 //    std::cout << "Hello, World!" << std::endl;
 //
@@ -337,6 +464,7 @@ int main() {
 
     std::thread v1(task1);
     std::thread v2(Task3);
+//    std::thread v2(Task4);
     v1.join(), v2.join();
     return 0;
 }
@@ -0,0 +1,134 @@
+#ifndef LOCK_GAURD_MCS_LOCK_H
+#define LOCK_GAURD_MCS_LOCK_H
+
+#include <atomic>
+#include <utility>
+
+#include "spin_wait.h"
+
+/*
+ * MCS queue lock (Mellor-Crummey and Scott)
+ * - With std::mutex or a ticket lock, all the waiters watch the same word
+ *      - Every unlock() is seen by every waiting core
+ *      - The cache line bounces between all of them ("thundering herd")
+ *
+ * - An MCS lock keeps a queue of waiters
+ *      - Each waiter has its own node, and spins on a flag in that node
+ *      - The lock itself is just a pointer to the last node in the queue
+ *      - unlock() clears the flag in the next waiter's node only
+ *      - Ownership passes in FIFO order
+ *
+ * - Nodes come from a small thread-local pool
+ *      - The caller does not need to supply one
+ *      - So McsLock has the usual lock(), try_lock() and unlock()
+ *      - It works with std::lock_guard, std::unique_lock and std::scoped_lock
+ *      - A thread can hold several MCS locks at once
+ *
+ * - Only use it with no more threads than cores
+ *      - If the next waiter in the queue is descheduled, nobody else can have the lock
+ *      */
+
+class McsLock {
+public:
+    McsLock() = default;
+    McsLock(const McsLock &source) = delete;
+    McsLock &operator=(const McsLock &source) = delete;
+
+    void lock() {
+        Node *node = NodePool::local().acquire();
+        Node *prev = tail.exchange(node, std::memory_order_acq_rel);
+        if (prev != nullptr) {
+            // Join the queue, then wait for our predecessor to hand over
+            prev->next.store(node, std::memory_order_release);
+            SpinWait spin;
+            while (node->waiting.load(std::memory_order_acquire)) {
+                spin.wait();
+            }
+        }
+        // Only the holder accesses owner
+        owner = node;
+    }
+
+    bool try_lock() {
+        Node *node = NodePool::local().acquire();
+        Node *expected {nullptr};
+        if (tail.compare_exchange_strong(expected, node, std::memory_order_acquire, std::memory_order_relaxed)) {
+            owner = node;
+            return true;
+        }
+        NodePool::local().release(node);
+        return false;
+    }
+
+    void unlock() {
+        Node *node = owner;
+        Node *succ = node->next.load(std::memory_order_acquire);
+        if (succ == nullptr) {
+            // No known successor: try to empty the queue
+            Node *expected {node};
+            if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) {
+                NodePool::local().release(node);
+                return;
+            }
+            // A new waiter swapped itself in, but has not linked to us yet
+            SpinWait spin;
+            while ((succ = node->next.load(std::memory_order_acquire)) == nullptr) {
+                spin.wait();
+            }
+        }
+        succ->waiting.store(false, std::memory_order_release);
+        NodePool::local().release(node);
+    }
+
+private:
+    struct alignas(64) Node {
+        std::atomic<Node *> next {nullptr};
+        std::atomic<bool> waiting {false};
+        Node *pool_next {nullptr};
+    };
+
+    // Free list of nodes, one per thread
+    class NodePool {
+    public:
+        static NodePool &local() {
+            thread_local NodePool pool;
+            return pool;
+        }
+
+        NodePool() = default;
+        NodePool(const NodePool &source) = delete;
+        NodePool &operator=(const NodePool &source) = delete;
+
+        ~NodePool() {
+            while (free_list != nullptr) {
+                delete std::exchange(free_list, free_list->pool_next);
+            }
+        }
+
+        Node *acquire() {
+            Node *node = free_list;
+            if (node != nullptr) {
+                free_list = node->pool_next;
+            }
+            else {
+                node = new Node;
+            }
+            node->next.store(nullptr, std::memory_order_relaxed);
+            node->waiting.store(true, std::memory_order_relaxed);
+            return node;
+        }
+
+        void release(Node *node) {
+            node->pool_next = free_list;
+            free_list = node;
+        }
+
+    private:
+        Node *free_list {nullptr};
+    };
+
+    std::atomic<Node *> tail {nullptr};
+    Node *owner {nullptr};
+};
+
+#endif //LOCK_GAURD_MCS_LOCK_H
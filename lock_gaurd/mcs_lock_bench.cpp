@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mcs_lock.h"
+#include "ticket_lock.h"
+
+using namespace std::literals;
+
+/*
+ * Lock scalability benchmark
+ * - Each thread repeatedly locks, increments a shared counter, and unlocks
+ *      - Like task() in main.cpp, without the printing and sleeping
+ *      - A few pause instructions outside the lock model the non-critical code
+ * - std::mutex vs TicketLock vs McsLock
+ * - From 1 thread up to all cores
+ *
+ * Usage: mcs_lock_bench [max threads] [milliseconds per run]
+ *      */
+
+// A few cycles of "work" outside the critical section
+void non_critical_work() {
+    for (int i{0}; i < 8; ++i) {
+        cpu_relax();
+    }
+}
+
+template <typename Lock>
+double ops_per_second(unsigned nthreads, std::chrono::milliseconds run_time) {
+    Lock lock;
+    long long counter {0};
+    std::atomic<bool> start {false};
+    std::atomic<bool> stop {false};
+    std::vector<long long> ops(nthreads);
+    std::vector<std::thread> threads;
+
+    for (unsigned t{0}; t < nthreads; ++t) {
+        threads.push_back(std::thread([&, t] {
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            long long n {0};
+            while (!stop.load(std::memory_order_relaxed)) {
+                {
+                    std::lock_guard<Lock> lck_guard(lock);
+                    ++counter;
+                }
+                ++n;
+                non_critical_work();
+            }
+            ops[t] = n;
+        }));
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(run_time);
+    stop.store(true, std::memory_order_relaxed);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    long long total {0};
+    for (auto n : ops) {
+        total += n;
+    }
+    if (total != counter) {
+        std::cerr << "lost updates: " << total << " != " << counter << std::endl;
+    }
+    return total / elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+    unsigned max_threads = argc > 1 ? std::atoi(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    auto run_time = std::chrono::milliseconds(argc > 2 ? std::atoi(argv[2]) : 500);
+
+    std::vector<unsigned> thread_counts;
+    for (unsigned n{1}; n < max_threads; n *= 2) {
+        thread_counts.push_back(n);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::cout << "Mops/s (lock + increment + unlock)" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "std::mutex"
+              << std::setw(14) << "TicketLock" << std::setw(14) << "McsLock" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (auto n : thread_counts) {
+        std::cout << std::setw(8) << n
+                  << std::setw(14) << ops_per_second<std::mutex>(n, run_time) / 1e6
+                  << std::setw(14) << ops_per_second<TicketLock>(n, run_time) / 1e6
+                  << std::setw(14) << ops_per_second<McsLock>(n, run_time) / 1e6 << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,151 @@
+#ifndef LOCK_GAURD_SEMAPHORE_H
+#define LOCK_GAURD_SEMAPHORE_H
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+
+#include "futex.h"
+
+/*
+ * Counting semaphore
+ * - C++20 has std::counting_semaphore, but this project is C++17
+ *
+ * - A semaphore holds a number of permits
+ *      - acquire() takes a permit, waiting until one is available
+ *      - release() gives a permit back
+ *      - A mutex is like a semaphore with one permit
+ *      - With n permits, up to n threads can be in the "critical section" at once
+ *
+ * - Fast path
+ *      - The permit count is an atomic
+ *      - acquire() and release() are a single compare-exchange or fetch_add
+ *      - No system call unless a thread has to sleep
+ *
+ * - Slow path
+ *      - A thread which cannot get enough permits sleeps on the count with futex_wait()
+ *      - release() only calls futex_wake() if somebody is waiting
+ *
+ * - Batch operations: acquire(n) and release(n)
+ *      - acquire(n) takes all n permits at once, or none
+ *
+ * - Timed acquire
+ *      - try_acquire_for() and try_acquire_until() give up at the deadline
+ *      - Deadlines are on std::chrono::steady_clock
+ *      */
+
+class CountingSemaphore {
+public:
+    explicit CountingSemaphore(std::uint32_t initial) : count(initial) {}
+    CountingSemaphore(const CountingSemaphore &source) = delete;
+    CountingSemaphore &operator=(const CountingSemaphore &source) = delete;
+
+    bool try_acquire(std::uint32_t n = 1) {
+        auto available = count.load(std::memory_order_relaxed);
+        while (available >= n) {
+            if (count.compare_exchange_weak(available, available - n,
+                                            std::memory_order_acquire, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void acquire(std::uint32_t n = 1) {
+        if (try_acquire(n)) {
+            return;
+        }
+        WaiterCount waiting(*this, n);
+        while (!try_acquire(n)) {
+            auto available = count.load(std::memory_order_seq_cst);
+            if (available < n) {
+                futex_wait(count, available);
+            }
+        }
+    }
+
+    template <typename Rep, typename Period>
+    bool try_acquire_for(const std::chrono::duration<Rep, Period> &timeout, std::uint32_t n = 1) {
+        return try_acquire_until(std::chrono::steady_clock::now()
+                                 + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout), n);
+    }
+
+    bool try_acquire_until(std::chrono::steady_clock::time_point deadline, std::uint32_t n = 1) {
+        if (try_acquire(n)) {
+            return true;
+        }
+        WaiterCount waiting(*this, n);
+        while (!try_acquire(n)) {
+            auto available = count.load(std::memory_order_seq_cst);
+            if (available < n && !futex_wait_until(count, available, deadline)) {
+                // Timed out - one last try, in case the permits arrived with the deadline
+                return try_acquire(n);
+            }
+        }
+        return true;
+    }
+
+    void release(std::uint32_t n = 1) {
+        count.fetch_add(n, std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_seq_cst) == 0) {
+            return;
+        }
+        // A batch waiter may need more than n permits, so it cannot take the place of a single waiter
+        if (batch_waiters.load(std::memory_order_relaxed) != 0 || n > INT_MAX) {
+            futex_wake_all(count);
+        }
+        else {
+            futex_wake(count, static_cast<int>(n));
+        }
+    }
+
+    std::uint32_t available() const { return count.load(std::memory_order_relaxed); }
+
+private:
+    // Registers a sleeping thread for as long as it is in the slow path
+    class WaiterCount {
+    public:
+        WaiterCount(CountingSemaphore &sem, std::uint32_t n) : sem(sem), batch(n > 1) {
+            if (batch) {
+                sem.batch_waiters.fetch_add(1, std::memory_order_relaxed);
+            }
+            // seq_cst pairs with release(): either it sees us waiting, or we see its permits
+            sem.waiters.fetch_add(1, std::memory_order_seq_cst);
+        }
+        ~WaiterCount() {
+            sem.waiters.fetch_sub(1, std::memory_order_relaxed);
+            if (batch) {
+                sem.batch_waiters.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        WaiterCount(const WaiterCount &source) = delete;
+        WaiterCount &operator=(const WaiterCount &source) = delete;
+
+    private:
+        CountingSemaphore &sem;
+        bool batch;
+    };
+
+    std::atomic<std::uint32_t> count;
+    std::atomic<std::uint32_t> waiters {0};
+    std::atomic<std::uint32_t> batch_waiters {0};
+};
+
+// RAII for permits, like std::lock_guard for a mutex
+class SemaphorePermit {
+public:
+    explicit SemaphorePermit(CountingSemaphore &sem, std::uint32_t n = 1) : sem(sem), n(n) {
+        sem.acquire(n);
+    }
+    ~SemaphorePermit() { sem.release(n); }
+
+    SemaphorePermit(const SemaphorePermit &source) = delete;
+    SemaphorePermit &operator=(const SemaphorePermit &source) = delete;
+
+private:
+    CountingSemaphore &sem;
+    std::uint32_t n;
+};
+
+#endif //LOCK_GAURD_SEMAPHORE_H
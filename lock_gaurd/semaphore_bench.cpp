@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "semaphore.h"
+#include "spin_wait.h"
+
+using namespace std::literals;
+
+/*
+ * Semaphore benchmark
+ * - CountingSemaphore (atomic fast path, futex slow path)
+ * - vs the textbook semaphore: a count protected by a mutex and condition variable
+ *
+ * - Uncontended: one thread, acquire() then release()
+ * - Contended: many threads sharing a few permits
+ * - Batch: acquire(2) / release(2)
+ * - Timed: how late try_acquire_for() returns when no permit arrives
+ *
+ * Usage: semaphore_bench [threads] [permits] [milliseconds per run]
+ *      */
+
+class CvSemaphore {
+public:
+    explicit CvSemaphore(std::uint32_t initial) : count(initial) {}
+
+    void acquire(std::uint32_t n = 1) {
+        std::unique_lock<std::mutex> uniq_lck(mut);
+        cv.wait(uniq_lck, [this, n] { return count >= n; });
+        count -= n;
+    }
+
+    template <typename Rep, typename Period>
+    bool try_acquire_for(const std::chrono::duration<Rep, Period> &timeout, std::uint32_t n = 1) {
+        std::unique_lock<std::mutex> uniq_lck(mut);
+        if (!cv.wait_for(uniq_lck, timeout, [this, n] { return count >= n; })) {
+            return false;
+        }
+        count -= n;
+        return true;
+    }
+
+    void release(std::uint32_t n = 1) {
+        {
+            std::lock_guard<std::mutex> lck_guard(mut);
+            count += n;
+        }
+        cv.notify_all();
+    }
+
+private:
+    std::mutex mut;
+    std::condition_variable cv;
+    std::uint32_t count;
+};
+
+template <typename Semaphore>
+double uncontended_ns(int iterations) {
+    Semaphore sem(1);
+    auto start = std::chrono::steady_clock::now();
+    for (int i{0}; i < iterations; ++i) {
+        sem.acquire();
+        sem.release();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+template <typename Semaphore>
+double contended_ops(unsigned nthreads, std::uint32_t permits, std::uint32_t batch,
+                     std::chrono::milliseconds run_time) {
+    Semaphore sem(permits);
+    std::atomic<bool> start {false};
+    std::atomic<bool> stop {false};
+    std::atomic<long long> total {0};
+    std::vector<std::thread> threads;
+
+    for (unsigned t{0}; t < nthreads; ++t) {
+        threads.push_back(std::thread([&] {
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            long long n {0};
+            while (!stop.load(std::memory_order_relaxed)) {
+                sem.acquire(batch);
+                for (int i{0}; i < 32; ++i) {
+                    cpu_relax();
+                }
+                sem.release(batch);
+                ++n;
+            }
+            total += n;
+        }));
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(run_time);
+    stop.store(true, std::memory_order_relaxed);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return total / elapsed.count();
+}
+
+template <typename Semaphore>
+double timeout_overshoot_us(std::chrono::milliseconds timeout) {
+    Semaphore sem(0);
+    auto start = std::chrono::steady_clock::now();
+    bool acquired = sem.try_acquire_for(timeout);
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    if (acquired) {
+        std::cerr << "unexpected acquire" << std::endl;
+    }
+    return elapsed.count() - std::chrono::duration<double, std::micro>(timeout).count();
+}
+
+int main(int argc, char *argv[]) {
+    unsigned nthreads = argc > 1 ? std::atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+    std::uint32_t permits = argc > 2 ? std::atoi(argv[2]) : 2;
+    auto run_time = std::chrono::milliseconds(argc > 3 ? std::atoi(argv[3]) : 500);
+
+    std::cout << std::setw(28) << "" << std::setw(20) << "CountingSemaphore" << std::setw(16) << "mutex+condvar" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::setw(28) << "uncontended (ns/op)"
+              << std::setw(20) << uncontended_ns<CountingSemaphore>(10000000)
+              << std::setw(16) << uncontended_ns<CvSemaphore>(10000000) << std::endl;
+
+    std::string label = std::to_string(nthreads) + " thr, " + std::to_string(permits) + " permits (Mops/s)";
+    std::cout << std::setw(28) << label
+              << std::setw(20) << contended_ops<CountingSemaphore>(nthreads, permits, 1, run_time) / 1e6
+              << std::setw(16) << contended_ops<CvSemaphore>(nthreads, permits, 1, run_time) / 1e6 << std::endl;
+
+    std::cout << std::setw(28) << "batch of 2 (Mops/s)"
+              << std::setw(20) << contended_ops<CountingSemaphore>(nthreads, permits * 2, 2, run_time) / 1e6
+              << std::setw(16) << contended_ops<CvSemaphore>(nthreads, permits * 2, 2, run_time) / 1e6 << std::endl;
+
+    std::cout << std::setw(28) << "10ms timeout overshoot (us)"
+              << std::setw(20) << timeout_overshoot_us<CountingSemaphore>(10ms)
+              << std::setw(16) << timeout_overshoot_us<CvSemaphore>(10ms) << std::endl;
+    return 0;
+}
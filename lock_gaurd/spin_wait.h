@@ -0,0 +1,48 @@
+#ifndef LOCK_GAURD_SPIN_WAIT_H
+#define LOCK_GAURD_SPIN_WAIT_H
+
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Spinning
+ * - A spinning thread keeps the core busy while it waits
+ *      - cpu_relax() tells the core it is in a spin loop
+ *      - x86 "pause", ARM "yield"
+ *      - Saves power, and gives the core to the other hyper-thread
+ *
+ * - If the lock holder has been descheduled, spinning only wastes its time slice
+ *      - SpinWait spins for a while, then starts yielding to the scheduler
+ *      */
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+class SpinWait {
+public:
+    void wait() {
+        if (count < spin_limit) {
+            ++count;
+            cpu_relax();
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+
+    void reset() { count = 0; }
+
+private:
+    static constexpr int spin_limit {1000};
+    int count {0};
+};
+
+#endif //LOCK_GAURD_SPIN_WAIT_H
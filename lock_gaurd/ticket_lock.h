@@ -0,0 +1,88 @@
+#ifndef LOCK_GAURD_TICKET_LOCK_H
+#define LOCK_GAURD_TICKET_LOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "spin_wait.h"
+
+/*
+ * Ticket lock
+ * - Like the queue at a deli counter
+ *      - lock() takes the next ticket number
+ *      - Then waits until its number is being served
+ *      - unlock() serves the next number
+ *
+ * - Strictly first come, first served (FIFO)
+ * - All waiters spin on the same now_serving word
+ *      - Every unlock() invalidates that cache line in every waiting core
+ *      - Every waiter then re-reads it, although only one of them can go
+ *
+ * - Proportional backoff
+ *      - A waiter knows how many threads are ahead of it: ticket - now_serving
+ *      - It waits for about that many critical sections before looking again
+ *      - The thread at the head of the queue checks often, the others rarely
+ *      - backoff_per_waiter is the pause count for one critical section
+ *      - If now_serving has not moved for yield_after pauses, it also yields between looks
+ *
+ * - Satisfies Lockable, so it works with std::lock_guard and std::unique_lock
+ * */
+
+class TicketLock {
+public:
+    explicit TicketLock(std::uint32_t backoff_per_waiter = 64) : backoff_per_waiter(backoff_per_waiter) {}
+    TicketLock(const TicketLock &source) = delete;
+    TicketLock &operator=(const TicketLock &source) = delete;
+
+    void lock() {
+        auto ticket = next_ticket.fetch_add(1, std::memory_order_relaxed);
+        std::uint32_t paused {0};
+        auto last_serving = now_serving.load(std::memory_order_relaxed);
+        while (true) {
+            auto serving = now_serving.load(std::memory_order_acquire);
+            if (serving == ticket) {
+                return;
+            }
+            // Only count the pauses since the queue last moved: a long wait far back in the queue is normal
+            if (serving != last_serving) {
+                last_serving = serving;
+                paused = 0;
+            }
+            auto distance = ticket - serving;
+            auto pauses = distance * backoff_per_waiter;
+            for (std::uint32_t i{0}; i < pauses; ++i) {
+                cpu_relax();
+            }
+            paused += pauses;
+            // The queue has not moved for a while, so the holder may have been descheduled -
+            // stop burning its time slice, but keep the proportional pause between looks
+            if (paused > yield_after) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool try_lock() {
+        auto serving = now_serving.load(std::memory_order_acquire);
+        auto ticket = serving;
+        // Only take a ticket if it would be served immediately
+        return next_ticket.compare_exchange_strong(ticket, serving + 1,
+                                                   std::memory_order_relaxed, std::memory_order_relaxed);
+    }
+
+    void unlock() {
+        // Only the holder writes now_serving
+        now_serving.store(now_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    static constexpr std::uint32_t yield_after {2000};
+
+    std::uint32_t backoff_per_waiter;
+    // Separate cache lines, so taking a ticket does not disturb the waiters
+    alignas(64) std::atomic<std::uint32_t> next_ticket {0};
+    alignas(64) std::atomic<std::uint32_t> now_serving {0};
+};
+
+#endif //LOCK_GAURD_TICKET_LOCK_H
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ticket_lock.h"
+
+using namespace std::literals;
+
+/*
+ * Ticket lock fairness benchmark
+ * - Short critical sections, like task() in main.cpp without the printing
+ *      - Lock with std::unique_lock, do a little work, unlock
+ * - Each thread counts how many times it acquired the lock
+ *      - Fair lock: every thread gets about the same number
+ *      - std::mutex lets the thread which just unlocked take it again
+ *
+ * - Reported
+ *      - Throughput (Mops/s)
+ *      - Fewest and most acquisitions by one thread, and max - min
+ *
+ * Usage: ticket_lock_bench [threads] [milliseconds per run]
+ *      */
+
+struct Result {
+    double ops_per_second;
+    long long min_acquisitions;
+    long long max_acquisitions;
+};
+
+void critical_section_work() {
+    for (int i{0}; i < 16; ++i) {
+        cpu_relax();
+    }
+}
+
+template <typename Lock>
+Result run(unsigned nthreads, std::chrono::milliseconds run_time) {
+    Lock lock;
+    long long counter {0};
+    std::atomic<bool> start {false};
+    std::atomic<bool> stop {false};
+    std::vector<long long> acquisitions(nthreads);
+    std::vector<std::thread> threads;
+
+    for (unsigned t{0}; t < nthreads; ++t) {
+        threads.push_back(std::thread([&, t] {
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            long long n {0};
+            while (!stop.load(std::memory_order_relaxed)) {
+                std::unique_lock<Lock> uniq_lck(lock);
+                // start of critical section
+                ++counter;
+                critical_section_work();
+                // end of critical section
+                uniq_lck.unlock();
+                ++n;
+            }
+            acquisitions[t] = n;
+        }));
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(run_time);
+    stop.store(true, std::memory_order_relaxed);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    auto [min_it, max_it] = std::minmax_element(acquisitions.begin(), acquisitions.end());
+    return {counter / elapsed.count(), *min_it, *max_it};
+}
+
+void print(const std::string &name, const Result &result) {
+    std::cout << std::setw(12) << name
+              << std::setw(10) << std::fixed << std::setprecision(2) << result.ops_per_second / 1e6
+              << std::setw(12) << result.min_acquisitions
+              << std::setw(12) << result.max_acquisitions
+              << std::setw(12) << result.max_acquisitions - result.min_acquisitions << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned nthreads = argc > 1 ? std::atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+    auto run_time = std::chrono::milliseconds(argc > 2 ? std::atoi(argv[2]) : 1000);
+
+    std::cout << nthreads << " threads, " << run_time.count() << " ms" << std::endl;
+    std::cout << std::setw(12) << "lock" << std::setw(10) << "Mops/s"
+              << std::setw(12) << "min" << std::setw(12) << "max" << std::setw(12) << "max-min" << std::endl;
+    print("std::mutex", run<std::mutex>(nthreads, run_time));
+    print("TicketLock", run<TicketLock>(nthreads, run_time));
+    return 0;
+}